@@ -0,0 +1,350 @@
+// Benchmark de ponta a ponta: gera cenas sintéticas de vários tamanhos e mede
+// cada fase (processGeoFile, svgDrawAll, visDrawRegion, visIsVisible e o
+// processQry completo), com repetições, mediana e p95, em CSV ou JSON.
+//
+// Uso: bench/bench [-sizes 100,250,500] [-bombs 2,8] [-runs 5]
+//                  [-json] [-o ficheiro]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "figure.h"
+#include "geo.h"
+#include "list.h"
+#include "qry.h"
+#include "stats.h"
+#include "svg.h"
+#include "svgwriter.h"
+#include "vis.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "desconhecida"
+#endif
+
+#define BENCH_MAX_SIZES 16
+#define BENCH_VIS_QUERIES 200
+
+typedef struct {
+  const char *phase;
+  int figures;
+  int bombs;
+  int runs;
+  double median;
+  double p95;
+  double min;
+} Result;
+
+static Result *g_results = NULL;
+static int g_resultCount = 0;
+
+static double nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+// Gerador congruencial próprio, para que as cenas sejam iguais em qualquer
+// máquina
+static unsigned int g_seed;
+
+static double rnd(void) {
+  g_seed = g_seed * 1103515245u + 12345u;
+  return ((g_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+// Cena uniforme com a mistura de formas de um .geo típico, numa área que
+// cresce com o número de figuras (densidade constante)
+static void writeGeo(const char *path, int figures, double side) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return;
+  for (int i = 1; i <= figures; i++) {
+    double x = rnd() * side, y = rnd() * side;
+    switch (i % 4) {
+    case 0:
+      fprintf(f, "r %d %.1f %.1f %.1f %.1f #000000 #aabbcc\n", i, x, y,
+              2 + rnd() * 20, 2 + rnd() * 20);
+      break;
+    case 1:
+      fprintf(f, "c %d %.1f %.1f %.1f #000000 #ccbbaa\n", i, x, y,
+              1 + rnd() * 8);
+      break;
+    case 2:
+      fprintf(f, "l %d %.1f %.1f %.1f %.1f #0000ff\n", i, x, y,
+              x + rnd() * 30 - 15, y + rnd() * 30 - 15);
+      break;
+    default:
+      fprintf(f, "t %d %.1f %.1f #000000 #00ff00 m alvo\n", i, x, y);
+      break;
+    }
+  }
+  fclose(f);
+}
+
+// Bombas alternando d e p, todas no SVG principal, e um cln no meio
+static void writeQry(const char *path, int bombs, double side) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return;
+  for (int b = 0; b < bombs; b++) {
+    double x = rnd() * side, y = rnd() * side;
+    if (b == bombs / 2)
+      fprintf(f, "cln %.1f %.1f 5 5 -\n", x, y);
+    else if (b % 2 == 0)
+      fprintf(f, "d %.1f %.1f -\n", x, y);
+    else
+      fprintf(f, "p %.1f %.1f #ff0000 -\n", x, y);
+  }
+  fclose(f);
+}
+
+static void freeScene(List figures) {
+  int count;
+  void **items = listToArray(figures, &count);
+  for (int i = 0; i < count; i++)
+    figureFree(items[i]);
+  TED_FREE(items);
+  listFree(figures);
+}
+
+// Invalida as caches de SVG das figuras, para medir a serialização a frio
+static void touchScene(List figures) {
+  int count;
+  void **items = listToArray(figures, &count);
+  char colorB[32], colorF[32];
+  for (int i = 0; i < count; i++) {
+    getFigureColors(items[i], colorB, colorF);
+    putFigureColor(items[i], colorB, colorF);
+  }
+  TED_FREE(items);
+}
+
+static List loadScene(const char *geoPath, FigureBounds bounds) {
+  List figures = listInit();
+  processGeoFile(geoPath, figures, bounds);
+  return figures;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void addResult(const char *phase, int figures, int bombs, double *times,
+                      int runs) {
+  qsort(times, (size_t)runs, sizeof(double), cmpDouble);
+  int p95 = (int)(0.95 * (runs - 1) + 0.5);
+  Result *grown = realloc(g_results, sizeof(Result) * (g_resultCount + 1));
+  if (!grown)
+    return;
+  g_results = grown;
+  Result *r = &g_results[g_resultCount++];
+  r->phase = phase;
+  r->figures = figures;
+  r->bombs = bombs;
+  r->runs = runs;
+  r->median = times[runs / 2];
+  r->p95 = times[p95];
+  r->min = times[0];
+  fprintf(stderr, "%-14s figuras=%-6d bombas=%-4d mediana=%9.3f ms p95=%9.3f ms\n",
+          phase, figures, bombs, r->median, r->p95);
+}
+
+// Mede as fases que dependem só do tamanho da cena
+static void benchScene(const char *geoPath, int figures, double side,
+                       int runs) {
+  double *times = malloc(sizeof(double) * runs);
+
+  for (int r = 0; r < runs; r++) {
+    List scene = listInit();
+    FigureBounds bounds = figureBoundsInit();
+    double start = nowMs();
+    processGeoFile(geoPath, scene, bounds);
+    times[r] = nowMs() - start;
+    freeScene(scene);
+    figureBoundsFree(bounds);
+  }
+  addResult("processGeoFile", figures, 0, times, runs);
+
+  FigureBounds bounds = figureBoundsInit();
+  List scene = loadScene(geoPath, bounds);
+  for (int r = 0; r < runs; r++) {
+    touchScene(scene);
+    SvgWriter w = svgWriterInitMemory();
+    double start = nowMs();
+    svgDrawAll(w, scene);
+    times[r] = nowMs() - start;
+    svgWriterClose(w);
+  }
+  addResult("svgDrawAll", figures, 0, times, runs);
+
+  // Uma bomba por corrida, sempre nos mesmos pontos
+  unsigned int seed = g_seed;
+  for (int r = 0; r < runs; r++) {
+    double x = rnd() * side, y = rnd() * side;
+    SvgWriter w = svgWriterInitMemory();
+    double start = nowMs();
+    visDrawRegion(scene, bounds, x, y, w, 'q', 10);
+    times[r] = nowMs() - start;
+    svgWriterClose(w);
+  }
+  addResult("visDrawRegion", figures, 1, times, runs);
+
+  g_seed = seed;
+  for (int r = 0; r < runs; r++) {
+    double start = nowMs();
+    for (int q = 0; q < BENCH_VIS_QUERIES; q++) {
+      double ox = rnd() * side, oy = rnd() * side;
+      double tx = rnd() * side, ty = rnd() * side;
+      visIsVisible(scene, bounds, ox, oy, tx, ty);
+    }
+    times[r] = (nowMs() - start) / BENCH_VIS_QUERIES;
+  }
+  addResult("visIsVisible", figures, 1, times, runs);
+
+  freeScene(scene);
+  figureBoundsFree(bounds);
+  free(times);
+}
+
+static void benchQry(const char *dir, const char *geoPath, int figures,
+                     int bombs, double side, int runs) {
+  char qryPath[512], outPath[512];
+  snprintf(qryPath, sizeof(qryPath), "%s/b%d.qry", dir, bombs);
+  snprintf(outPath, sizeof(outPath), "%s/out.svg", dir);
+  writeQry(qryPath, bombs, side);
+
+  double *times = malloc(sizeof(double) * runs);
+  for (int r = 0; r < runs; r++) {
+    // A consulta altera a cena: cada corrida parte do .geo de novo
+    FigureBounds bounds = figureBoundsInit();
+    List scene = loadScene(geoPath, bounds);
+    double start = nowMs();
+    processQry(qryPath, outPath, scene, bounds, 'q', 10, NULL);
+    times[r] = nowMs() - start;
+    freeScene(scene);
+    figureBoundsFree(bounds);
+  }
+  addResult("processQry", figures, bombs, times, runs);
+  free(times);
+}
+
+static int parseList(const char *s, int *out, int max) {
+  int n = 0;
+  while (*s && n < max) {
+    out[n++] = atoi(s);
+    s = strchr(s, ',');
+    if (!s)
+      break;
+    s++;
+  }
+  return n;
+}
+
+static void writeCsv(FILE *f) {
+  fprintf(f, "versao,fase,figuras,bombas,corridas,mediana_ms,p95_ms,min_ms\n");
+  for (int i = 0; i < g_resultCount; i++) {
+    Result *r = &g_results[i];
+    fprintf(f, "%s,%s,%d,%d,%d,%.4f,%.4f,%.4f\n", BENCH_VERSION, r->phase,
+            r->figures, r->bombs, r->runs, r->median, r->p95, r->min);
+  }
+}
+
+static void writeJson(FILE *f) {
+  fprintf(f, "{\n  \"versao\": \"%s\",\n  \"resultados\": [\n", BENCH_VERSION);
+  for (int i = 0; i < g_resultCount; i++) {
+    Result *r = &g_results[i];
+    fprintf(f,
+            "    {\"fase\": \"%s\", \"figuras\": %d, \"bombas\": %d, "
+            "\"corridas\": %d, \"mediana_ms\": %.4f, \"p95_ms\": %.4f, "
+            "\"min_ms\": %.4f}%s\n",
+            r->phase, r->figures, r->bombs, r->runs, r->median, r->p95, r->min,
+            i + 1 < g_resultCount ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+  // O processQry é quadrático no número de figuras (visIsVisible por figura),
+  // por isso os tamanhos por omissão são modestos
+  int sizes[BENCH_MAX_SIZES] = {100, 250, 500};
+  int sizeCount = 3;
+  int bombs[BENCH_MAX_SIZES] = {2, 8};
+  int bombCount = 2;
+  int runs = 5;
+  bool json = false;
+  const char *outName = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-sizes") == 0 && i + 1 < argc)
+      sizeCount = parseList(argv[++i], sizes, BENCH_MAX_SIZES);
+    else if (strcmp(argv[i], "-bombs") == 0 && i + 1 < argc)
+      bombCount = parseList(argv[++i], bombs, BENCH_MAX_SIZES);
+    else if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+      runs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-json") == 0)
+      json = true;
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      outName = argv[++i];
+    else {
+      fprintf(stderr,
+              "uso: %s [-sizes a,b,c] [-bombs a,b] [-runs n] [-json] [-o "
+              "ficheiro]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (runs < 1)
+    runs = 1;
+
+  char dir[] = "/tmp/tedbenchXXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  for (int s = 0; s < sizeCount; s++) {
+    int figures = sizes[s];
+    // Uma figura a cada 20 x 20 unidades, em média
+    double side = 20.0 * sqrt((double)figures);
+    char geoPath[512];
+    snprintf(geoPath, sizeof(geoPath), "%s/n%d.geo", dir, figures);
+    g_seed = 12345u + (unsigned)figures;
+    writeGeo(geoPath, figures, side);
+
+    benchScene(geoPath, figures, side, runs);
+    for (int b = 0; b < bombCount; b++)
+      benchQry(dir, geoPath, figures, bombs[b], side, runs);
+    remove(geoPath);
+  }
+
+  char path[600];
+  for (int b = 0; b < bombCount; b++) {
+    snprintf(path, sizeof(path), "%s/b%d.qry", dir, bombs[b]);
+    remove(path);
+  }
+  snprintf(path, sizeof(path), "%s/out.svg", dir);
+  remove(path);
+  rmdir(dir);
+
+  FILE *out = outName ? fopen(outName, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "ERRO: Não foi possível abrir %s\n", outName);
+    return 1;
+  }
+  if (json)
+    writeJson(out);
+  else
+    writeCsv(out);
+  if (out != stdout)
+    fclose(out);
+  free(g_results);
+  return 0;
+}
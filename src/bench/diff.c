@@ -0,0 +1,688 @@
+// Comparação diferencial entre motores de visibilidade. Para cada cena gerada
+// e cada observador, corre o motor de referência (visDrawRegion com qsort e
+// visIsVisible) e os motores alternativos da tabela g_engines, e verifica:
+//   - o conjunto de figuras cujo centro (o ponto testado em qry.c) cai dentro
+//     do polígono desenhado pelo motor é igual ao da referência;
+//   - os polígonos coincidem dentro da tolerância, medida como a área da
+//     diferença simétrica sobre a área da referência (perfil radial visto do
+//     observador, que é interior ao polígono em estrela);
+//   - o polígono do motor bate com um lançamento de raios direto contra todas
+//     as arestas da cena (força bruta, sem a varredura): a fração de raios
+//     cuja distância difere não passa do limiar -rays;
+//   - isVisible dá as mesmas respostas, quando o motor tem o seu próprio
+//     (hoje todos usam visIsVisible, e a coluna fica a "-");
+//   - o ganho de tempo de drawRegion (mediana das razões referência / motor,
+//     medidos alternadamente) não caiu mais do que o limiar em relação a um
+//     ficheiro de base gravado antes com -save. O isVisible é medido à parte,
+//     só a título informativo.
+// Sai com 1 se algum motor divergir ou regredir.
+//
+// Uso: bench/diff [-engine nome] [-sizes 100,300] [-obs n] [-runs n] [-tol 1e-3]
+//                 [-rays 0.02] [-thr 0.2] [-baseline ficheiro] [-save ficheiro]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "figure.h"
+#include "geom.h"
+#include "list.h"
+#include "stats.h"
+#include "svgwriter.h"
+#include "vis.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DIFF_MAX_SIZES 16
+#define DIFF_MAX_BASE 128
+// Amostras angulares do perfil radial
+#define DIFF_RAYS 2880
+// geomRaySegmentIntersect devolve 100000 quando o raio falha o segmento
+#define DIFF_MISS 99999.0
+// Raios da verificação por força bruta, e a diferença de distância tolerada
+// (os arcos são tesselados, com erro proporcional à distância)
+#define DIFF_TRUTH_RAYS 1440
+#define DIFF_TRUTH_ABS 0.05
+#define DIFF_TRUTH_REL 0.01
+
+// --- Motores ---
+
+// Um motor de visibilidade: desenha o polígono num escritor e testa alvos.
+// Para comparar um motor novo basta acrescentá-lo a g_engines.
+typedef struct {
+  const char *name;
+  void (*drawRegion)(List figures, FigureBounds bounds, double ox, double oy, SvgWriter svg);
+  bool (*isVisible)(List figures, FigureBounds bounds, double ox, double oy, double tx,
+                    double ty);
+} Engine;
+
+static void refDraw(List figures, FigureBounds bounds, double ox, double oy, SvgWriter svg) {
+  visDrawRegion(figures, bounds, ox, oy, svg, 'q', 10);
+}
+
+static void mergeDraw(List figures, FigureBounds bounds, double ox, double oy, SvgWriter svg) {
+  visDrawRegion(figures, bounds, ox, oy, svg, 'm', 10);
+}
+
+static void mergeInsertionDraw(List figures, FigureBounds bounds, double ox, double oy,
+                               SvgWriter svg) {
+  visDrawRegion(figures, bounds, ox, oy, svg, 'm', 64);
+}
+
+// O primeiro é a referência
+static const Engine g_engines[] = {
+    {"ref", refDraw, visIsVisible},
+    {"merge", mergeDraw, visIsVisible},
+    {"merge-in64", mergeInsertionDraw, visIsVisible},
+};
+#define DIFF_ENGINE_COUNT (int)(sizeof(g_engines) / sizeof(g_engines[0]))
+
+// --- Cenas ---
+
+static const char *g_distNames[] = {"uniforme", "cluster", "muros", "retangulos"};
+#define DIFF_DIST_COUNT 4
+
+static unsigned int g_seed;
+
+static double rnd(void) {
+  g_seed = g_seed * 1103515245u + 12345u;
+  return ((g_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+static List buildScene(int dist, int figures, double side, FigureBounds bounds) {
+  List scene = listInit();
+  double cx[4], cy[4];
+  for (int c = 0; c < 4; c++) {
+    cx[c] = (0.2 + 0.6 * rnd()) * side;
+    cy[c] = (0.2 + 0.6 * rnd()) * side;
+  }
+  for (int i = 1; i <= figures; i++) {
+    double x = rnd() * side, y = rnd() * side;
+    if (dist == 1 || dist == 3) {
+      int c = (int)(rnd() * 4);
+      x = cx[c] + (rnd() + rnd() + rnd() - 1.5) * side * 0.1;
+      y = cy[c] + (rnd() + rnd() + rnd() - 1.5) * side * 0.1;
+    }
+    Figure f;
+    // Retângulos que se sobrepõem: arestas de figuras diferentes cruzam-se
+    // junto aos vértices partilhados pela varredura
+    if (dist == 3) {
+      f = figureInit(RECTANGLE);
+      setRectangle(f, i, x, y, 5 + rnd() * 30, 5 + rnd() * 30, "#000000", "#aabbcc");
+      figureBoundsAdd(bounds, f);
+      listAddFirst(scene, f);
+      continue;
+    }
+    switch (i % 4) {
+    case 0:
+      f = figureInit(RECTANGLE);
+      setRectangle(f, i, x, y, 2 + rnd() * 20, 2 + rnd() * 20, "#000000", "#aabbcc");
+      break;
+    case 1:
+      f = figureInit(CIRCLE);
+      setCircle(f, i, x, y, 1 + rnd() * 8, "#000000", "#ccbbaa");
+      break;
+    case 2: {
+      double len = dist == 2 ? side * (0.2 + 0.4 * rnd()) : 30 * rnd();
+      bool horizontal = rnd() < 0.5;
+      f = figureInit(LINE);
+      setLine(f, i, x, y, horizontal ? x + len : x, horizontal ? y : y + len, "#0000ff");
+      break;
+    }
+    default:
+      f = figureInit(TEXT);
+      setText(f, i, x, y, "#000000", "#00ff00", 'm', "alvo", "sans-serif", "n", 8);
+      break;
+    }
+    figureBoundsAdd(bounds, f);
+    listAddFirst(scene, f);
+  }
+  return scene;
+}
+
+static void freeScene(List scene) {
+  int count;
+  void **items = listToArray(scene, &count);
+  for (int i = 0; i < count; i++)
+    figureFree(items[i]);
+  TED_FREE(items);
+  listFree(scene);
+}
+
+// Mesmo ponto testado pelos comandos d/p/cln em qry.c
+static void figureCenter(Figure f, double *x, double *y) {
+  getFigureXY(x, y, f);
+  if (getFigureShape(f) == RECTANGLE) {
+    double w, h;
+    getRectangleWH(f, &w, &h);
+    *x += w / 2.0;
+    *y += h / 2.0;
+  }
+}
+
+// --- Polígonos ---
+
+typedef struct {
+  double *xs, *ys;
+  int count;
+} Polygon;
+
+// Lê de volta o "<path d="M ox oy L x y ... Z" ..."/> escrito pelo motor; o
+// primeiro vértice é o próprio observador e fica de fora
+static Polygon parsePolygon(SvgWriter w) {
+  Polygon p = {NULL, NULL, 0};
+  size_t len;
+  const char *data = svgWriterData(w, &len);
+  if (!data || len == 0)
+    return p;
+  char *text = malloc(len + 1);
+  memcpy(text, data, len);
+  text[len] = '\0';
+
+  int capacity = 0;
+  for (const char *c = text; *c; c++)
+    if (*c == 'L')
+      capacity++;
+  p.xs = malloc(sizeof(double) * (capacity + 1));
+  p.ys = malloc(sizeof(double) * (capacity + 1));
+  const char *c = strchr(text, 'M');
+  while (c && (c = strchr(c + 1, 'L')) != NULL) {
+    char *end;
+    double x = strtod(c + 1, &end);
+    double y = strtod(end, &end);
+    p.xs[p.count] = x;
+    p.ys[p.count] = y;
+    p.count++;
+    c = end;
+  }
+  free(text);
+  return p;
+}
+
+// Distância do observador até à fronteira do polígono no ângulo dado
+static double radialDistance(const Polygon *p, double ox, double oy, double angle) {
+  double dx = cos(angle), dy = sin(angle);
+  double best = 0.0;
+  for (int i = 0; i < p->count; i++) {
+    int j = (i + 1) % p->count;
+    double ex = p->xs[j] - p->xs[i], ey = p->ys[j] - p->ys[i];
+    double den = dx * ey - dy * ex;
+    if (fabs(den) < 1e-12)
+      continue;
+    double ax = p->xs[i] - ox, ay = p->ys[i] - oy;
+    double t = (ax * ey - ay * ex) / den;
+    double u = (ax * dy - ay * dx) / den;
+    if (t >= 0 && u >= -1e-9 && u <= 1 + 1e-9 && t > best && t < DIFF_MISS)
+      best = t;
+  }
+  return best;
+}
+
+// Par-ímpar com um raio horizontal para a direita
+static bool polygonContains(const Polygon *p, double x, double y) {
+  bool inside = false;
+  for (int i = 0, j = p->count - 1; i < p->count; j = i++) {
+    if ((p->ys[i] > y) != (p->ys[j] > y) &&
+        x < (p->xs[j] - p->xs[i]) * (y - p->ys[i]) / (p->ys[j] - p->ys[i]) + p->xs[i])
+      inside = !inside;
+  }
+  return inside;
+}
+
+// Área da diferença simétrica / área da referência, pelos perfis radiais
+static double polygonDifference(const Polygon *ref, const Polygon *other, double ox, double oy) {
+  if (ref->count == 0 || other->count == 0)
+    return (ref->count == other->count) ? 0.0 : 1.0;
+  double diff = 0, area = 0;
+  for (int k = 0; k < DIFF_RAYS; k++) {
+    double angle = (k + 0.5) * 2 * PI / DIFF_RAYS;
+    double r1 = radialDistance(ref, ox, oy, angle);
+    double r2 = radialDistance(other, ox, oy, angle);
+    diff += fabs(r1 * r1 - r2 * r2);
+    area += r1 * r1;
+  }
+  return area > 0 ? diff / area : 0.0;
+}
+
+// --- Força bruta ---
+
+// Menor t > 0 com a raiz de |o + t*d - c| = r, ou DIFF_MISS
+static double rayCircle(double ox, double oy, double dx, double dy, double cx,
+                        double cy, double r) {
+  double wx = cx - ox, wy = cy - oy;
+  double b = dx * wx + dy * wy;
+  double disc = b * b - (wx * wx + wy * wy - r * r);
+  if (disc < 0)
+    return DIFF_MISS;
+  double t = b - sqrt(disc);
+  if (t <= 0)
+    t = b + sqrt(disc);
+  return t > 0 ? t : DIFF_MISS;
+}
+
+static double raySegment(double ox, double oy, double dx, double dy, double x1,
+                         double y1, double x2, double y2) {
+  double ex = x2 - x1, ey = y2 - y1;
+  double den = dx * ey - dy * ex;
+  if (fabs(den) < 1e-12)
+    return DIFF_MISS;
+  double ax = x1 - ox, ay = y1 - oy;
+  double t = (ax * ey - ay * ex) / den;
+  double u = (ax * dy - ay * dx) / den;
+  return (t >= 0 && u >= 0 && u <= 1) ? t : DIFF_MISS;
+}
+
+// Distância até ao primeiro obstáculo no ângulo dado, testando todas as
+// figuras e as paredes da caixa do mundo
+static double rayCast(Figure *figs, int count, const double *world, double ox,
+                      double oy, double angle) {
+  double dx = cos(angle), dy = sin(angle);
+  double best = DIFF_MISS;
+  double walls[4][4] = {{world[2], world[1], world[2], world[3]},
+                        {world[2], world[3], world[0], world[3]},
+                        {world[0], world[3], world[0], world[1]},
+                        {world[0], world[1], world[2], world[1]}};
+  for (int k = 0; k < 4; k++) {
+    double t = raySegment(ox, oy, dx, dy, walls[k][0], walls[k][1], walls[k][2], walls[k][3]);
+    if (t < best)
+      best = t;
+  }
+  for (int i = 0; i < count; i++) {
+    double x, y, t = DIFF_MISS;
+    getFigureXY(&x, &y, figs[i]);
+    switch (getFigureShape(figs[i])) {
+    case RECTANGLE: {
+      double w, h;
+      getRectangleWH(figs[i], &w, &h);
+      double xs[4] = {x, x + w, x + w, x}, ys[4] = {y, y, y + h, y + h};
+      for (int k = 0; k < 4; k++) {
+        double e = raySegment(ox, oy, dx, dy, xs[k], ys[k], xs[(k + 1) % 4], ys[(k + 1) % 4]);
+        if (e < t)
+          t = e;
+      }
+      break;
+    }
+    case CIRCLE:
+      t = rayCircle(ox, oy, dx, dy, x, y, getCircleR(figs[i]));
+      break;
+    case LINE: {
+      double x1, y1, x2, y2;
+      getLineP(figs[i], &x1, &y1, &x2, &y2);
+      t = raySegment(ox, oy, dx, dy, x1, y1, x2, y2);
+      break;
+    }
+    default:
+      break;
+    }
+    if (t < best)
+      best = t;
+  }
+  return best;
+}
+
+// Fração dos raios em que o polígono não acaba no obstáculo mais próximo
+static double wrongRays(const Polygon *p, Figure *figs, int count, const double *world,
+                        double ox, double oy) {
+  int wrong = 0;
+  for (int k = 0; k < DIFF_TRUTH_RAYS; k++) {
+    double angle = (k + 0.5) * 2 * PI / DIFF_TRUTH_RAYS;
+    double truth = rayCast(figs, count, world, ox, oy, angle);
+    double got = radialDistance(p, ox, oy, angle);
+    if (fabs(got - truth) > DIFF_TRUTH_ABS + DIFF_TRUTH_REL * truth)
+      wrong++;
+  }
+  return (double)wrong / DIFF_TRUTH_RAYS;
+}
+
+// Caixa do mundo com que visDrawRegion fecha o polígono: cena e observador,
+// com a mesma margem
+static void worldBox(FigureBounds bounds, double ox, double oy, double *world) {
+  world[0] = world[2] = ox;
+  world[1] = world[3] = oy;
+  double minX, minY, maxX, maxY;
+  if (figureBoundsGet(bounds, &minX, &minY, &maxX, &maxY)) {
+    world[0] = fmin(world[0], minX);
+    world[1] = fmin(world[1], minY);
+    world[2] = fmax(world[2], maxX);
+    world[3] = fmax(world[3], maxY);
+  }
+  world[0] -= 20.0;
+  world[1] -= 20.0;
+  world[2] += 20.0;
+  world[3] += 20.0;
+}
+
+static void freePolygon(Polygon *p) {
+  free(p->xs);
+  free(p->ys);
+}
+
+// --- Execução ---
+
+typedef struct {
+  double visibleMs;  // uma passagem de isVisible por todas as figuras
+  Polygon *polygons; // um por observador
+  bool *inside;      // observadores x figuras: centro dentro do polígono
+  bool *visible;     // observadores x figuras: resposta de isVisible
+} EngineRun;
+
+static double nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double median(double *values, int count) {
+  qsort(values, (size_t)count, sizeof(double), cmpDouble);
+  return values[count / 2];
+}
+
+// As linhas ficam de fora do conjunto (como em qry.c): o seu ponto está
+// sobre o próprio segmento, na fronteira do polígono
+static void fillInside(EngineRun *run, Figure *figs, int count, int observers) {
+  for (int o = 0; o < observers; o++) {
+    for (int i = 0; i < count; i++) {
+      double fx, fy;
+      figureCenter(figs[i], &fx, &fy);
+      run->inside[o * count + i] = getFigureShape(figs[i]) != LINE &&
+                                   polygonContains(&run->polygons[o], fx, fy);
+    }
+  }
+}
+
+// Resultados de um motor: polígonos, conjunto dentro deles e, se pedido, as
+// respostas de isVisible (cronometradas, só a título informativo)
+static EngineRun runEngine(const Engine *e, List scene, FigureBounds bounds, Figure *figs,
+                           int count, const double *obs, int observers, bool withVisible) {
+  EngineRun run;
+  run.polygons = calloc(observers, sizeof(Polygon));
+  run.inside = calloc((size_t)observers * count, sizeof(bool));
+  run.visible = calloc((size_t)observers * count, sizeof(bool));
+  SvgWriter w = svgWriterInitMemory();
+  svgWriterSetPrecision(w, 9);
+  for (int o = 0; o < observers; o++) {
+    svgWriterReset(w);
+    e->drawRegion(scene, bounds, obs[2 * o], obs[2 * o + 1], w);
+    run.polygons[o] = parsePolygon(w);
+  }
+  svgWriterClose(w);
+  fillInside(&run, figs, count, observers);
+
+  run.visibleMs = 0;
+  if (!withVisible)
+    return run;
+  double start = nowMs();
+  for (int o = 0; o < observers; o++) {
+    for (int i = 0; i < count; i++) {
+      double fx, fy;
+      figureCenter(figs[i], &fx, &fy);
+      run.visible[o * count + i] = e->isVisible(scene, bounds, obs[2 * o], obs[2 * o + 1], fx, fy);
+    }
+  }
+  run.visibleMs = nowMs() - start;
+  return run;
+}
+
+static double timeDraw(const Engine *e, List scene, FigureBounds bounds, const double *obs,
+                       int observers, SvgWriter w) {
+  double start = nowMs();
+  for (int o = 0; o < observers; o++) {
+    svgWriterReset(w);
+    e->drawRegion(scene, bounds, obs[2 * o], obs[2 * o + 1], w);
+  }
+  return nowMs() - start;
+}
+
+// Só drawRegion conta para o ganho. Referência e motor alternam em cada
+// corrida, e o ganho é a mediana das razões por corrida, para que uma
+// variação do relógio da máquina afete os dois por igual
+static double measureSpeedup(const Engine *ref, const Engine *e, List scene,
+                             FigureBounds bounds, const double *obs, int observers, int runs,
+                             double *refMs, double *engineMs) {
+  double *refTimes = malloc(sizeof(double) * runs);
+  double *engineTimes = malloc(sizeof(double) * runs);
+  double *ratios = malloc(sizeof(double) * runs);
+  SvgWriter w = svgWriterInitMemory();
+  for (int r = 0; r < runs; r++) {
+    // A ordem troca de corrida para corrida
+    if (r % 2 == 0) {
+      refTimes[r] = timeDraw(ref, scene, bounds, obs, observers, w);
+      engineTimes[r] = timeDraw(e, scene, bounds, obs, observers, w);
+    } else {
+      engineTimes[r] = timeDraw(e, scene, bounds, obs, observers, w);
+      refTimes[r] = timeDraw(ref, scene, bounds, obs, observers, w);
+    }
+    ratios[r] = engineTimes[r] > 0 ? refTimes[r] / engineTimes[r] : 0;
+  }
+  svgWriterClose(w);
+  *refMs = median(refTimes, runs);
+  *engineMs = median(engineTimes, runs);
+  double speedup = median(ratios, runs);
+  free(refTimes);
+  free(engineTimes);
+  free(ratios);
+  return speedup;
+}
+
+static void freeRun(EngineRun *run, int observers) {
+  for (int o = 0; o < observers; o++)
+    freePolygon(&run->polygons[o]);
+  free(run->polygons);
+  free(run->inside);
+  free(run->visible);
+}
+
+// --- Base ---
+
+typedef struct {
+  char engine[32];
+  char scene[32];
+  double speedup;
+} BaseEntry;
+
+static BaseEntry g_base[DIFF_MAX_BASE];
+static int g_baseCount = 0;
+static BaseEntry g_measured[DIFF_MAX_BASE];
+static int g_measuredCount = 0;
+
+static bool loadBaseline(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f) && g_baseCount < DIFF_MAX_BASE) {
+    BaseEntry *b = &g_base[g_baseCount];
+    if (line[0] != '#' && sscanf(line, "%31s %31s %lf", b->engine, b->scene, &b->speedup) == 3)
+      g_baseCount++;
+  }
+  fclose(f);
+  return true;
+}
+
+static const BaseEntry *findBase(const char *engine, const char *scene) {
+  for (int i = 0; i < g_baseCount; i++)
+    if (strcmp(g_base[i].engine, engine) == 0 && strcmp(g_base[i].scene, scene) == 0)
+      return &g_base[i];
+  return NULL;
+}
+
+static bool saveBaseline(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  fprintf(f, "# motor cena ganho (tempo da referência / tempo do motor)\n");
+  for (int i = 0; i < g_measuredCount; i++)
+    fprintf(f, "%s %s %.4f\n", g_measured[i].engine, g_measured[i].scene,
+            g_measured[i].speedup);
+  return fclose(f) == 0;
+}
+
+static int parseList(const char *s, int *out, int max) {
+  int n = 0;
+  while (*s && n < max) {
+    out[n++] = atoi(s);
+    s = strchr(s, ',');
+    if (!s)
+      break;
+    s++;
+  }
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  const char *only = NULL, *baseline = NULL, *save = NULL;
+  int sizes[DIFF_MAX_SIZES] = {100, 300};
+  int sizeCount = 2;
+  int observers = 6;
+  int runs = 21;
+  double tolerance = 1e-3, threshold = 0.2, rayTolerance = 0.02;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "-engine") == 0 && hasValue)
+      only = argv[++i];
+    else if (strcmp(argv[i], "-sizes") == 0 && hasValue)
+      sizeCount = parseList(argv[++i], sizes, DIFF_MAX_SIZES);
+    else if (strcmp(argv[i], "-obs") == 0 && hasValue)
+      observers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-runs") == 0 && hasValue)
+      runs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-tol") == 0 && hasValue)
+      tolerance = atof(argv[++i]);
+    else if (strcmp(argv[i], "-rays") == 0 && hasValue)
+      rayTolerance = atof(argv[++i]);
+    else if (strcmp(argv[i], "-thr") == 0 && hasValue)
+      threshold = atof(argv[++i]);
+    else if (strcmp(argv[i], "-baseline") == 0 && hasValue)
+      baseline = argv[++i];
+    else if (strcmp(argv[i], "-save") == 0 && hasValue)
+      save = argv[++i];
+    else {
+      fprintf(stderr,
+              "uso: %s [-engine nome] [-sizes 100,300] [-obs n] [-runs n] [-tol 1e-3]\n"
+              "          [-rays 0.02] [-thr 0.2] [-baseline ficheiro] [-save ficheiro]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (observers < 1 || sizeCount < 1 || runs < 1) {
+    fprintf(stderr, "ERRO: -obs, -runs e -sizes têm de ser positivos\n");
+    return 1;
+  }
+  if (baseline && !loadBaseline(baseline))
+    fprintf(stderr, "AVISO: Sem ficheiro de base em %s; sem verificação de ganho\n", baseline);
+
+  // O isVisible só é comparado nos motores que não usam o da referência
+  bool anyVisible = false;
+  for (int e = 1; e < DIFF_ENGINE_COUNT; e++)
+    if (g_engines[e].isVisible != g_engines[0].isVisible &&
+        (!only || strcmp(only, g_engines[e].name) == 0))
+      anyVisible = true;
+
+  bool failed = false;
+  printf("%-12s %-14s %8s %8s %8s %10s %8s %10s %10s %8s %10s  %s\n", "motor", "cena",
+         "dentro", "difer.", "visible", "poligono", "raios", "ref_ms", "motor_ms", "ganho",
+         "visible_ms", "estado");
+
+  for (int d = 0; d < DIFF_DIST_COUNT; d++) {
+    for (int s = 0; s < sizeCount; s++) {
+      int figures = sizes[s];
+      double side = 20.0 * sqrt((double)figures);
+      g_seed = 1234u + 7919u * (unsigned)figures + (unsigned)d;
+      FigureBounds bounds = figureBoundsInit();
+      List scene = buildScene(d, figures, side, bounds);
+      double *obs = malloc(sizeof(double) * 2 * observers);
+      for (int o = 0; o < observers; o++) {
+        obs[2 * o] = rnd() * side;
+        obs[2 * o + 1] = rnd() * side;
+      }
+      int count;
+      Figure *figs = (Figure *)listToArray(scene, &count);
+      char sceneName[32];
+      snprintf(sceneName, sizeof(sceneName), "%s-%d", g_distNames[d], figures);
+
+      EngineRun ref =
+          runEngine(&g_engines[0], scene, bounds, figs, count, obs, observers, anyVisible);
+      for (int e = 1; e < DIFF_ENGINE_COUNT; e++) {
+        const Engine *engine = &g_engines[e];
+        if (only && strcmp(only, engine->name) != 0)
+          continue;
+        bool ownVisible = engine->isVisible != g_engines[0].isVisible;
+        EngineRun run = runEngine(engine, scene, bounds, figs, count, obs, observers, ownVisible);
+
+        int mismatches = 0, insideCount = 0, visibleMismatches = 0;
+        for (int k = 0; k < observers * count; k++) {
+          insideCount += ref.inside[k];
+          mismatches += ref.inside[k] != run.inside[k];
+          if (ownVisible)
+            visibleMismatches += ref.visible[k] != run.visible[k];
+        }
+        char visibleColumn[16] = "-", visibleMs[16] = "-";
+        if (ownVisible) {
+          snprintf(visibleColumn, sizeof(visibleColumn), "%d", visibleMismatches);
+          snprintf(visibleMs, sizeof(visibleMs), "%.2f", run.visibleMs);
+        }
+        double worst = 0, worstRays = 0;
+        for (int o = 0; o < observers; o++) {
+          double diff = polygonDifference(&ref.polygons[o], &run.polygons[o], obs[2 * o],
+                                          obs[2 * o + 1]);
+          if (diff > worst)
+            worst = diff;
+          double world[4];
+          worldBox(bounds, obs[2 * o], obs[2 * o + 1], world);
+          double rays = wrongRays(&run.polygons[o], figs, count, world, obs[2 * o],
+                                  obs[2 * o + 1]);
+          if (rays > worstRays)
+            worstRays = rays;
+        }
+        double refMs, engineMs;
+        double speedup = measureSpeedup(&g_engines[0], engine, scene, bounds, obs, observers, runs,
+                                        &refMs, &engineMs);
+
+        const char *status = "ok";
+        if (mismatches > 0 || visibleMismatches > 0 || worst > tolerance ||
+            worstRays > rayTolerance) {
+          status = "DIVERGE";
+          failed = true;
+        } else {
+          const BaseEntry *b = findBase(engine->name, sceneName);
+          if (b && speedup < b->speedup * (1.0 - threshold)) {
+            status = "REGRIDE";
+            failed = true;
+          }
+        }
+        printf("%-12s %-14s %8d %8d %8s %10.2e %8.4f %10.2f %10.2f %8.3f %10s  %s\n",
+               engine->name, sceneName, insideCount, mismatches, visibleColumn, worst,
+               worstRays, refMs, engineMs, speedup, visibleMs, status);
+        fflush(stdout);
+
+        if (g_measuredCount < DIFF_MAX_BASE) {
+          BaseEntry *m = &g_measured[g_measuredCount++];
+          snprintf(m->engine, sizeof(m->engine), "%s", engine->name);
+          snprintf(m->scene, sizeof(m->scene), "%s", sceneName);
+          m->speedup = speedup;
+        }
+        freeRun(&run, observers);
+      }
+      freeRun(&ref, observers);
+      TED_FREE(figs);
+      free(obs);
+      freeScene(scene);
+      figureBoundsFree(bounds);
+    }
+  }
+
+  if (save && !saveBaseline(save)) {
+    fprintf(stderr, "ERRO: Não foi possível gravar %s\n", save);
+    return 1;
+  }
+  return failed ? 1 : 0;
+}
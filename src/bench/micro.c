@@ -0,0 +1,318 @@
+// Microbenchmarks das estruturas base: árvore de segmentos ativos (com o
+// comparador da varredura), lista encadeada, geomRaySegmentIntersect e a
+// ordenação de eventos (qsort contra mergeSortHybrid com vários limiares -in).
+// Para cada caso reporta ns/op e alocações/op; "op" é uma chamada, ou um
+// elemento no caso das ordenações.
+//
+// vis.c é incluído diretamente para chegar aos tipos e funções internas
+// (Segment, Event, visTreeCompare, mergeSortHybrid); o vis.o não é ligado.
+// As alocações são contadas com -Wl,--wrap=malloc (ver Makefile), pelo que só
+// entram as feitas pelo código do projeto (não as internas da libc, como as
+// do qsort).
+//
+// Uso: bench/micro [-csv] [-ms tempo_mínimo_por_caso]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "vis.c"
+
+#include <string.h>
+#include <time.h>
+
+#define MICRO_MIN_MS 50.0
+
+// --- Contagem de Alocações ---
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+static long g_allocs = 0;
+
+void *__wrap_malloc(size_t size) {
+  g_allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  g_allocs++;
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+  g_allocs++;
+  return __real_realloc(p, size);
+}
+
+// --- Medição ---
+
+// Uma ronda do caso; devolve o número de operações feitas
+typedef long (*MicroRound)(void *ctx);
+
+static double g_minMs = MICRO_MIN_MS;
+static bool g_csv = false;
+static volatile double g_sink;
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1.0e9 + ts.tv_nsec;
+}
+
+// Aquece com uma ronda e repete rondas até passar o tempo mínimo
+static void measure(const char *name, int n, const char *param, MicroRound round,
+                    void *ctx) {
+  round(ctx);
+  long ops = 0;
+  long allocs = g_allocs;
+  double start = nowNs(), elapsed;
+  do {
+    ops += round(ctx);
+    elapsed = nowNs() - start;
+  } while (elapsed < g_minMs * 1.0e6);
+  allocs = g_allocs - allocs;
+
+  double nsOp = elapsed / ops;
+  double allocsOp = (double)allocs / ops;
+  if (g_csv)
+    printf("%s,%d,%s,%.3f,%.4f\n", name, n, param, nsOp, allocsOp);
+  else
+    printf("%-22s n=%-7d %-6s %12.2f ns/op %10.4f allocs/op\n", name, n, param,
+           nsOp, allocsOp);
+  fflush(stdout);
+}
+
+static unsigned int g_seed = 12345;
+
+static double rnd(void) {
+  g_seed = g_seed * 1103515245u + 12345u;
+  return ((g_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+static void shuffle(void **items, int n) {
+  for (int i = n - 1; i > 0; i--) {
+    int j = (int)(rnd() * (i + 1));
+    void *t = items[i];
+    items[i] = items[j];
+    items[j] = t;
+  }
+}
+
+// --- Árvore ---
+
+// Segmentos verticais cortados pelo raio de ângulo 0 a partir da origem,
+// todos a distâncias diferentes: a mesma situação da varredura em vis.c
+typedef struct {
+  int n;
+  Segment *segs;
+  void **order;
+  Tree tree;
+} TreeCtx;
+
+static void treeCtxInit(TreeCtx *c, int n) {
+  c->n = n;
+  c->segs = calloc(n, sizeof(Segment));
+  c->order = malloc(n * sizeof(void *));
+  for (int i = 0; i < n; i++) {
+    double d = 1.0 + i * 0.5 + rnd() * 0.25;
+    c->segs[i].p1.x = d;
+    c->segs[i].p1.y = -10.0;
+    c->segs[i].p2.x = d;
+    c->segs[i].p2.y = 10.0;
+    c->segs[i].kind = SEG_LINE;
+    c->segs[i].originalId = i;
+    c->order[i] = &c->segs[i];
+  }
+  shuffle(c->order, n);
+  g_ox = 0.0;
+  g_oy = 0.0;
+  g_currentAngle = 0.0;
+  c->tree = NULL;
+}
+
+static void treeCtxFree(TreeCtx *c) {
+  if (c->tree)
+    treeFree(c->tree, NULL);
+  free(c->segs);
+  free(c->order);
+}
+
+static void treeFill(TreeCtx *c) {
+  c->tree = treeInit(visTreeCompare);
+  for (int i = 0; i < c->n; i++)
+    treeInsert(c->tree, c->order[i]);
+}
+
+static long roundTreeInsert(void *ctx) {
+  TreeCtx *c = ctx;
+  treeFill(c);
+  treeFree(c->tree, NULL);
+  c->tree = NULL;
+  return c->n;
+}
+
+static long roundTreeMin(void *ctx) {
+  TreeCtx *c = ctx;
+  for (int i = 0; i < c->n; i++)
+    g_sink = ((Segment *)treeMin(c->tree))->p1.x;
+  return c->n;
+}
+
+// Remove tudo e volta a inserir; só as remoções contam como operações, mas
+// as inserções entram no tempo (ver ns/op de treeInsert para descontar)
+static long roundTreeRemove(void *ctx) {
+  TreeCtx *c = ctx;
+  for (int i = 0; i < c->n; i++)
+    treeRemove(c->tree, c->order[i]);
+  for (int i = 0; i < c->n; i++)
+    treeInsert(c->tree, c->order[i]);
+  return c->n;
+}
+
+static void benchTree(int n) {
+  TreeCtx c;
+  treeCtxInit(&c, n);
+  measure("treeInsert", n, "-", roundTreeInsert, &c);
+  treeFill(&c);
+  measure("treeMin", n, "-", roundTreeMin, &c);
+  measure("treeRemove+Insert", n, "-", roundTreeRemove, &c);
+  treeCtxFree(&c);
+}
+
+// --- Lista ---
+
+typedef struct {
+  int n;
+  List list;
+} ListCtx;
+
+static long roundListAddLast(void *ctx) {
+  ListCtx *c = ctx;
+  List l = listInit();
+  for (int i = 0; i < c->n; i++)
+    listAddLast(l, c);
+  listFree(l);
+  return c->n;
+}
+
+// O padrão while (listGetPos(l, i++)) usado em vis.c e qry.c
+static long roundListGetPos(void *ctx) {
+  ListCtx *c = ctx;
+  int i = 0;
+  void *data;
+  long visited = 0;
+  while ((data = listGetPos(c->list, i++)))
+    visited++;
+  return visited;
+}
+
+static void benchList(int n) {
+  ListCtx c = {n, listInit()};
+  measure("listAddLast", n, "-", roundListAddLast, &c);
+  for (int i = 0; i < n; i++)
+    listAddFirst(c.list, &c);
+  measure("listGetPos", n, "-", roundListGetPos, &c);
+  listFree(c.list);
+}
+
+// --- Interseção Raio-Segmento ---
+
+#define MICRO_RAYS 4096
+
+typedef struct {
+  double angle[MICRO_RAYS];
+  double seg[MICRO_RAYS][4];
+} RayCtx;
+
+static long roundRaySegment(void *ctx) {
+  RayCtx *c = ctx;
+  double acc = 0;
+  for (int i = 0; i < MICRO_RAYS; i++)
+    acc += geomRaySegmentIntersect(0.0, 0.0, c->angle[i], c->seg[i][0],
+                                   c->seg[i][1], c->seg[i][2], c->seg[i][3]);
+  g_sink = acc;
+  return MICRO_RAYS;
+}
+
+static void benchRaySegment(void) {
+  RayCtx *c = malloc(sizeof(RayCtx));
+  for (int i = 0; i < MICRO_RAYS; i++) {
+    c->angle[i] = rnd() * 2 * VIS_PI;
+    for (int k = 0; k < 4; k++)
+      c->seg[i][k] = rnd() * 200.0 - 100.0;
+  }
+  measure("geomRaySegmentIntersect", MICRO_RAYS, "-", roundRaySegment, c);
+  free(c);
+}
+
+// --- Ordenação de Eventos ---
+
+typedef struct {
+  int n;
+  int threshold; // 0 = qsort
+  Event *source;
+  Event *work;
+} SortCtx;
+
+static long roundSort(void *ctx) {
+  SortCtx *c = ctx;
+  memcpy(c->work, c->source, c->n * sizeof(Event));
+  if (c->threshold > 0)
+    mergeSortHybrid(c->work, 0, c->n - 1, c->threshold);
+  else
+    qsort(c->work, c->n, sizeof(Event), visEventCompare);
+  return c->n;
+}
+
+static void benchSort(int n) {
+  static const int thresholds[] = {1, 8, 16, 32, 64};
+  SortCtx c = {n, 0, malloc(n * sizeof(Event)), malloc(n * sizeof(Event))};
+  // Ângulos em grelha, para haver empates resolvidos pelo tipo, como nos
+  // vértices partilhados de uma cena real
+  for (int i = 0; i < n; i++) {
+    c.source[i].angle = (int)(rnd() * n / 2) * (2 * VIS_PI / (n / 2 + 1));
+    c.source[i].type = (int)(rnd() * 3);
+    c.source[i].seg = NULL;
+    c.source[i].next = NULL;
+  }
+  measure("qsort", n, "-", roundSort, &c);
+  for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++) {
+    char param[16];
+    snprintf(param, sizeof(param), "in=%d", thresholds[t]);
+    c.threshold = thresholds[t];
+    measure("mergeSortHybrid", n, param, roundSort, &c);
+  }
+  free(c.source);
+  free(c.work);
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-csv") == 0)
+      g_csv = true;
+    else if (strcmp(argv[i], "-ms") == 0 && i + 1 < argc)
+      g_minMs = atof(argv[++i]);
+    else {
+      fprintf(stderr, "uso: %s [-csv] [-ms tempo_mínimo_por_caso]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (g_csv)
+    printf("caso,n,param,ns_op,allocs_op\n");
+
+  static const int treeSizes[] = {64, 1024, 16384};
+  for (int i = 0; i < 3; i++)
+    benchTree(treeSizes[i]);
+
+  static const int listSizes[] = {100, 1000, 10000};
+  for (int i = 0; i < 3; i++)
+    benchList(listSizes[i]);
+
+  benchRaySegment();
+
+  static const int sortSizes[] = {256, 4096, 65536};
+  for (int i = 0; i < 3; i++)
+    benchSort(sortSizes[i]);
+  return 0;
+}
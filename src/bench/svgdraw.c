@@ -0,0 +1,145 @@
+// Mede svgDrawAll com 1..N threads sobre uma cena sintética e confirma que a
+// saída é idêntica à da versão sequencial.
+//
+// Uso: bench/svgdraw [figuras] [threads máx.] [repetições]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "figure.h"
+#include "list.h"
+#include "stats.h"
+#include "svg.h"
+#include "svgwriter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+// Cena determinística com a mistura de formas de um .geo típico. Insere pelo
+// início (listAddLast percorre a lista inteira a cada inserção).
+static List buildScene(int count) {
+  List figures = listInit();
+  unsigned int seed = 12345;
+  for (int i = 0; i < count; i++) {
+    seed = seed * 1103515245u + 12345u;
+    double x = (seed >> 8) % 100000 / 10.0;
+    seed = seed * 1103515245u + 12345u;
+    double y = (seed >> 8) % 100000 / 10.0;
+    Figure f;
+    switch (i % 4) {
+    case 0:
+      f = figureInit(RECTANGLE);
+      setRectangle(f, i, x, y, 12.5, 7.25, "black", "#aabbcc");
+      break;
+    case 1:
+      f = figureInit(CIRCLE);
+      setCircle(f, i, x, y, 3.125, "red", "none");
+      break;
+    case 2:
+      f = figureInit(LINE);
+      setLine(f, i, x, y, x + 40.0, y - 13.3, "blue");
+      break;
+    default:
+      f = figureInit(TEXT);
+      setText(f, i, x, y, "black", "green", 'm', "bombinha", "sans", "b", 12);
+      break;
+    }
+    listAddFirst(figures, f);
+  }
+  return figures;
+}
+
+// Invalida as caches de SVG das figuras, para medir a serialização a frio
+static void touchScene(Figure *figures, int count) {
+  char colorB[32], colorF[32];
+  for (int i = 0; i < count; i++) {
+    getFigureColors(figures[i], colorB, colorF);
+    putFigureColor(figures[i], colorB, colorF);
+  }
+}
+
+static double runOnce(List scene, Figure *figures, int count, int threads,
+                      char **out, size_t *outLen) {
+  touchScene(figures, count);
+  svgSetThreads(threads);
+  SvgWriter w = svgWriterInitMemory();
+  double start = nowMs();
+  svgDrawAll(w, scene);
+  double elapsed = nowMs() - start;
+
+  size_t len;
+  const char *data = svgWriterData(w, &len);
+  *out = malloc(len);
+  memcpy(*out, data, len);
+  *outLen = len;
+  svgWriterClose(w);
+  return elapsed;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 400000;
+  int maxThreads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int reps = argc > 3 ? atoi(argv[3]) : 5;
+  if (count < 1 || maxThreads < 1 || reps < 1) {
+    fprintf(stderr, "uso: %s [figuras] [threads] [repetições]\n", argv[0]);
+    return 1;
+  }
+
+  List scene = buildScene(count);
+  int n;
+  Figure *figures = (Figure *)listToArray(scene, &n);
+
+  char *reference;
+  size_t referenceLen;
+  runOnce(scene, figures, n, 1, &reference, &referenceLen);
+
+  double *times = malloc((size_t)reps * sizeof(double));
+  double base = 0.0;
+  printf("figuras=%d bytes=%zu cpus=%ld\n", n, referenceLen,
+         sysconf(_SC_NPROCESSORS_ONLN));
+  printf("threads,mediana_ms,min_ms,aceleracao,identico\n");
+  // 1, 2, 4, ... e por fim o máximo pedido
+  for (int threads = 1; threads <= maxThreads;
+       threads = (threads < maxThreads && threads * 2 > maxThreads)
+                     ? maxThreads
+                     : threads * 2) {
+    int identical = 1;
+    for (int r = 0; r < reps; r++) {
+      char *out;
+      size_t len;
+      times[r] = runOnce(scene, figures, n, threads, &out, &len);
+      if (len != referenceLen || memcmp(out, reference, len) != 0)
+        identical = 0;
+      free(out);
+    }
+    qsort(times, (size_t)reps, sizeof(double), cmpDouble);
+    double median = times[reps / 2];
+    if (threads == 1)
+      base = median;
+    printf("%d,%.2f,%.2f,%.2f,%s\n", threads, median, times[0], base / median,
+           identical ? "sim" : "NAO");
+    if (!identical)
+      return 2;
+  }
+
+  free(times);
+  free(reference);
+  for (int i = 0; i < n; i++)
+    figureFree(figures[i]);
+  TED_FREE(figures);
+  listFree(scene);
+  return 0;
+}
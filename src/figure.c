@@ -1,4 +1,6 @@
 #include "figure.h"
+#include "probes.h"
+#include "stats.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -42,32 +44,165 @@ typedef struct {
 typedef struct {
   void *form;
   int shape;
+  char *cache;
+  size_t cacheLen;
+  int cacheTag;
+  unsigned long version; // versão da cena na última alteração
 } figure;
 
+// Caixa envolvente de uma cena (só cresce)
+typedef struct {
+  bool has;
+  double minX, minY, maxX, maxY;
+} bounds;
+
+// Versão da cena: incrementada a cada alteração de qualquer figura
+static unsigned long g_sceneVersion = 0;
+
+static void invalidateCache(figure *fig) {
+  TED_FREE(fig->cache);
+  fig->cache = NULL;
+  fig->cacheLen = 0;
+}
+
+static void figureChanged(figure *fig) {
+  invalidateCache(fig);
+  fig->version = ++g_sceneVersion;
+}
+
+unsigned long figureSceneVersion(void) { return g_sceneVersion; }
+
+static void growBounds(bounds *b, double x, double y) {
+  if (!b->has) {
+    b->minX = b->maxX = x;
+    b->minY = b->maxY = y;
+    b->has = true;
+    return;
+  }
+  if (x < b->minX)
+    b->minX = x;
+  if (x > b->maxX)
+    b->maxX = x;
+  if (y < b->minY)
+    b->minY = y;
+  if (y > b->maxY)
+    b->maxY = y;
+}
+
+FigureBounds figureBoundsInit(void) { return TED_CALLOC(1, sizeof(bounds)); }
+
+void figureBoundsFree(FigureBounds b) { TED_FREE(b); }
+
+void figureBoundsAdd(FigureBounds fb, Figure f) {
+  if (!fb || !f)
+    return;
+  bounds *b = (bounds *)fb;
+  figure *fig = (figure *)f;
+  switch (fig->shape) {
+  case CIRCLE:
+    Circle *c = (Circle *)fig->form;
+    growBounds(b, c->x - c->radius, c->y - c->radius);
+    growBounds(b, c->x + c->radius, c->y + c->radius);
+    break;
+  case RECTANGLE:
+    Rectangle *r = (Rectangle *)fig->form;
+    growBounds(b, r->x, r->y);
+    growBounds(b, r->x + r->weight, r->y + r->height);
+    break;
+  case LINE:
+    Line *l = (Line *)fig->form;
+    growBounds(b, l->x1, l->y1);
+    growBounds(b, l->x2, l->y2);
+    break;
+  }
+}
+
+bool figureBoundsGet(FigureBounds fb, double *minX, double *minY, double *maxX,
+                     double *maxY) {
+  bounds *b = (bounds *)fb;
+  if (!b || !b->has)
+    return false;
+  *minX = b->minX;
+  *minY = b->minY;
+  *maxX = b->maxX;
+  *maxY = b->maxY;
+  return true;
+}
+
+unsigned long figureVersion(Figure f) {
+  if (!f)
+    return 0;
+  return ((figure *)f)->version;
+}
+
+bool figureGetExtent(Figure f, double *minX, double *minY, double *maxX,
+                     double *maxY) {
+  figure *fig = (figure *)f;
+  if (!fig || !fig->form)
+    return false;
+  switch (fig->shape) {
+  case CIRCLE:
+    Circle *c = (Circle *)fig->form;
+    *minX = c->x - c->radius;
+    *minY = c->y - c->radius;
+    *maxX = c->x + c->radius;
+    *maxY = c->y + c->radius;
+    return true;
+  case RECTANGLE:
+    Rectangle *r = (Rectangle *)fig->form;
+    *minX = r->x;
+    *minY = r->y;
+    *maxX = r->x + r->weight;
+    *maxY = r->y + r->height;
+    return true;
+  case LINE:
+    Line *l = (Line *)fig->form;
+    *minX = fmin(l->x1, l->x2);
+    *minY = fmin(l->y1, l->y2);
+    *maxX = fmax(l->x1, l->x2);
+    *maxY = fmax(l->y1, l->y2);
+    return true;
+  case TEXT:
+    // Estimativa: um quadrado do tamanho da fonte à volta da âncora
+    Text *t = (Text *)fig->form;
+    *minX = t->x - t->size;
+    *minY = t->y - t->size;
+    *maxX = t->x + t->size;
+    *maxY = t->y + t->size;
+    return true;
+  default:
+    return false;
+  }
+}
+
 Figure figureInit(int shape) {
-  figure *f = malloc(sizeof(figure));
+  figure *f = TED_MALLOC(sizeof(figure));
   if (!f)
     return NULL;
   f->shape = shape;
+  f->cache = NULL;
+  f->cacheLen = 0;
+  f->cacheTag = 0;
+  f->version = 0;
   switch (f->shape) {
   case CIRCLE:
-    f->form = malloc(sizeof(Circle));
+    f->form = TED_MALLOC(sizeof(Circle));
     break;
   case RECTANGLE:
-    f->form = malloc(sizeof(Rectangle));
+    f->form = TED_MALLOC(sizeof(Rectangle));
     break;
   case LINE:
-    f->form = malloc(sizeof(Line));
+    f->form = TED_MALLOC(sizeof(Line));
     break;
   case TEXT:
-    f->form = malloc(sizeof(Text));
+    f->form = TED_MALLOC(sizeof(Text));
     break;
   default:
-    free(f);
+    TED_FREE(f);
     return NULL;
   }
   if (!f->form) {
-    free(f);
+    TED_FREE(f);
     return NULL;
   }
   return (Figure)f;
@@ -78,14 +213,16 @@ void figureFree(Figure f) {
     return;
   figure *del = (figure *)f;
   if (del->form)
-    free(del->form);
-  free(del);
+    TED_FREE(del->form);
+  TED_FREE(del->cache);
+  TED_FREE(del);
 }
 
 void setCircle(Figure f, int id, double x, double y, double r,
                const char *colorB, const char *colorF) {
   if (!f || ((figure *)f)->shape != CIRCLE)
     return;
+  TED_PROBE2(figure__set__circle, id, TED_MILLI(r));
   Circle *c = (Circle *)((figure *)f)->form;
   c->id = id;
   c->x = x;
@@ -93,6 +230,7 @@ void setCircle(Figure f, int id, double x, double y, double r,
   c->radius = r;
   strcpy(c->colorB, colorB);
   strcpy(c->colorF, colorF);
+  figureChanged((figure *)f);
 }
 
 void setRectangle(Figure f, int id, double x, double y, double w, double h,
@@ -107,6 +245,7 @@ void setRectangle(Figure f, int id, double x, double y, double w, double h,
   r->height = h;
   strcpy(r->colorB, colorB);
   strcpy(r->colorF, colorF);
+  figureChanged((figure *)f);
 }
 
 void setLine(Figure f, int id, double x1, double y1, double x2, double y2,
@@ -120,6 +259,7 @@ void setLine(Figure f, int id, double x1, double y1, double x2, double y2,
   l->x2 = x2;
   l->y2 = y2;
   strcpy(l->color, color);
+  figureChanged((figure *)f);
 }
 
 void setText(Figure f, int id, double x, double y, const char *colorB,
@@ -138,6 +278,7 @@ void setText(Figure f, int id, double x, double y, const char *colorB,
   strcpy(t->family, family);
   strcpy(t->weight, weight);
   t->size = size;
+  figureChanged((figure *)f);
 }
 
 Figure fClone(Figure f) {
@@ -205,6 +346,7 @@ void fMoveTo(Figure f, double x, double y) {
   default:
     return;
   }
+  figureChanged(fig);
 }
 
 double figureArea(Figure f) {
@@ -249,6 +391,7 @@ void figureInvertColors(Figure f) {
   if (!f)
     return;
   figure *fig = (figure *)f;
+  figureChanged(fig);
   char temp[cLen];
   switch (fig->shape) {
   case CIRCLE:
@@ -477,6 +620,8 @@ void putFigureColor(Figure f, const char *colorB, const char *colorF) {
   if (!f)
     return;
   figure *fig = (figure *)f;
+  TED_PROBE1(figure__color, getFigureId(f));
+  figureChanged(fig);
   switch (fig->shape) {
   case CIRCLE:
     Circle *c = (Circle *)fig->form;
@@ -513,3 +658,26 @@ int getFigureType(Figure f) {
   figure *fig = (figure *)f;
   return fig->shape;
 }
+
+void figureSetCache(Figure f, const char *data, size_t len, int tag) {
+  if (!f)
+    return;
+  figure *fig = (figure *)f;
+  invalidateCache(fig);
+  fig->cache = TED_MALLOC(len);
+  if (!fig->cache)
+    return;
+  memcpy(fig->cache, data, len);
+  fig->cacheLen = len;
+  fig->cacheTag = tag;
+}
+
+const char *figureGetCache(Figure f, int tag, size_t *len) {
+  if (!f)
+    return NULL;
+  figure *fig = (figure *)f;
+  if (!fig->cache || fig->cacheTag != tag)
+    return NULL;
+  *len = fig->cacheLen;
+  return fig->cache;
+}
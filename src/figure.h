@@ -1,6 +1,9 @@
 #ifndef FIGURE_H
 #define FIGURE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 // --- Tipos de Figuras ---
 #define CIRCLE 1
 #define RECTANGLE 2
@@ -226,4 +229,91 @@ void putFigureColor(Figure f, const char *colorB, const char *colorF);
 int getFigureShape(Figure f);
 
 int getFigureType(Figure f);
+
+/**
+ * @brief Um tipo opaco para a caixa envolvente de uma cena.
+ */
+typedef void *FigureBounds;
+
+/**
+ * @brief Cria uma caixa envolvente vazia. Cada cena tem a sua: quem lê ou
+ * altera as figuras (processGeoFile, processQry) acrescenta-as à caixa, e
+ * quem precisa dos limites da cena (vis, tiles, heatmap, tune) recebe-a.
+ * @return A caixa, ou NULL se a alocação falhar.
+ */
+FigureBounds figureBoundsInit(void);
+
+/**
+ * @brief Liberta uma caixa envolvente.
+ * @param b A caixa (pode ser NULL).
+ */
+void figureBoundsFree(FigureBounds b);
+
+/**
+ * @brief Alarga a caixa para conter um círculo, retângulo ou linha, em O(1).
+ * Deve ser chamada depois de a figura ser configurada ou movida. A caixa
+ * nunca encolhe, então continua conservadora depois de figuras serem
+ * destruídas ou libertadas.
+ * @param b A caixa (sem efeito se for NULL).
+ * @param f A figura; os textos são ignorados.
+ */
+void figureBoundsAdd(FigureBounds b, Figure f);
+
+/**
+ * @brief Obtém os limites de uma caixa envolvente.
+ * @param b A caixa.
+ * @param minX, minY Canto mínimo da caixa.
+ * @param maxX, maxY Canto máximo da caixa.
+ * @return false se a caixa for NULL ou nenhuma figura contribuiu ainda (os
+ * parâmetros ficam intactos).
+ */
+bool figureBoundsGet(FigureBounds b, double *minX, double *minY, double *maxX,
+                     double *maxY);
+
+/**
+ * @brief Obtém a versão da cena, incrementada sempre que alguma figura é
+ * configurada ou alterada (set*, fMoveTo, figureInvertColors, putFigureColor).
+ * @return A versão atual.
+ */
+unsigned long figureSceneVersion(void);
+
+/**
+ * @brief Obtém a versão da cena em que a figura foi alterada pela última vez
+ * (ver figureSceneVersion).
+ * @param f A figure.
+ * @return A versão, ou 0 se a figura nunca foi configurada.
+ */
+unsigned long figureVersion(Figure f);
+
+/**
+ * @brief Obtém a caixa envolvente de uma figura. Para textos é uma
+ * estimativa: um quadrado com o tamanho da fonte à volta da âncora.
+ * @param f A figure.
+ * @param minX, minY Canto mínimo da caixa.
+ * @param maxX, maxY Canto máximo da caixa.
+ * @return false se a figura não tiver forma.
+ */
+bool figureGetExtent(Figure f, double *minX, double *minY, double *maxX,
+                     double *maxY);
+
+/**
+ * @brief Guarda uma cópia da representação serializada da figura (ex.: o
+ * elemento SVG). A cópia é descartada por qualquer função que altere a
+ * figura (set*, fMoveTo, figureInvertColors, putFigureColor).
+ * @param f A figure.
+ * @param data Os bytes a guardar.
+ * @param len Quantidade de bytes.
+ * @param tag Identifica o formato (ex.: a precisão usada); figureGetCache só
+ * devolve a cópia se o tag coincidir.
+ */
+void figureSetCache(Figure f, const char *data, size_t len, int tag);
+
+/**
+ * @brief Obtém a representação serializada guardada por figureSetCache.
+ * @param f A figure.
+ * @param tag O formato pretendido.
+ * @param len Recebe a quantidade de bytes.
+ * @return Os bytes, ou NULL se não houver cópia válida para o tag.
+ */
+const char *figureGetCache(Figure f, int tag, size_t *len);
 #endif
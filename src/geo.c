@@ -83,7 +83,7 @@ static void processTs(const char *line, Ts *t) {
   }
 }
 
-static void parseGeoLine(char *lineBuffer, List figureList, Ts *t) {
+static void parseGeoLine(char *lineBuffer, List figureList, FigureBounds bounds, Ts *t) {
   char command[16];
   Figure newFig = NULL;
 
@@ -105,10 +105,11 @@ static void parseGeoLine(char *lineBuffer, List figureList, Ts *t) {
 
   if (newFig != NULL) {
     listAddLast(figureList, newFig);
+    figureBoundsAdd(bounds, newFig);
   }
 }
 
-void processGeoFile(const char *geoFilePath, List figureList) {
+void processGeoFile(const char *geoFilePath, List figureList, FigureBounds bounds) {
   FILE *file = fopen(geoFilePath, "r");
   if (!file) {
     return;
@@ -118,7 +119,7 @@ void processGeoFile(const char *geoFilePath, List figureList) {
   Ts *t = tsInit();
 
   while (fgets(lineBuffer, sizeof(lineBuffer), file)) {
-    parseGeoLine(lineBuffer, figureList, t);
+    parseGeoLine(lineBuffer, figureList, bounds, t);
   }
 
   free(t);
@@ -1,6 +1,7 @@
 #ifndef GEO_H
 #define GEO_H
 
+#include "figure.h"
 #include "list.h"
 
 /**
@@ -8,7 +9,8 @@
  * a uma lista.
  * @param geoFilePath O caminho completo para o arquivo .geo a ser lido
  * @param figureList A Lista (List) onde as figures criadas serão armazenadas.
+ * @param bounds Caixa envolvente da cena, alargada com cada figura lida.
  */
-void processGeoFile(const char *geoFilePath, List figureList);
+void processGeoFile(const char *geoFilePath, List figureList, FigureBounds bounds);
 
 #endif // GEO_H
@@ -0,0 +1,225 @@
+#include "heatmap.h"
+#include "figure.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A mesma margem que a varredura usa à volta da cena
+#define HEAT_MARGIN 20.0
+#define HEAT_MAX_CELLS 16384
+#define HEAT_MAX_THREADS 64
+// Abaixo deste trabalho (linhas x arestas) o preenchimento é sequencial
+#define HEAT_PARALLEL_MIN (1 << 16)
+
+static uint32_t *g_counts = NULL;
+static int g_width = 0, g_height = 0;
+static double g_x0, g_y0, g_cell;
+static int g_threads = 1;
+
+// Polígono a preencher e faixa de linhas de uma thread
+typedef struct {
+  const double *xs;
+  const double *ys;
+  int n;
+  int rowStart;
+  int rowEnd;
+  double *crossings; // espaço para n interseções
+} FillJob;
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Varrimento por linhas: interseta a linha que passa pelo centro das células
+// com as arestas e preenche entre pares de interseções
+static void fillRows(FillJob *job) {
+  const double *xs = job->xs, *ys = job->ys;
+  for (int row = job->rowStart; row < job->rowEnd; row++) {
+    double y = g_y0 + (row + 0.5) * g_cell;
+    int k = 0;
+    for (int i = 0, j = job->n - 1; i < job->n; j = i++) {
+      // Meio-aberto em y para não contar vértices duas vezes
+      if ((ys[i] > y) != (ys[j] > y)) {
+        double t = (y - ys[i]) / (ys[j] - ys[i]);
+        job->crossings[k++] = xs[i] + t * (xs[j] - xs[i]);
+      }
+    }
+    if (k < 2)
+      continue;
+    qsort(job->crossings, k, sizeof(double), cmpDouble);
+
+    uint32_t *line = g_counts + (size_t)row * g_width;
+    for (int c = 0; c + 1 < k; c += 2) {
+      // Células cujo centro está em [xa, xb)
+      int from = (int)ceil((job->crossings[c] - g_x0) / g_cell - 0.5);
+      int to = (int)ceil((job->crossings[c + 1] - g_x0) / g_cell - 0.5);
+      if (from < 0)
+        from = 0;
+      if (to > g_width)
+        to = g_width;
+      for (int col = from; col < to; col++)
+        line[col]++;
+    }
+  }
+}
+
+static void *fillWorker(void *arg) {
+  fillRows((FillJob *)arg);
+  return NULL;
+}
+
+bool heatmapInit(FigureBounds bounds, int cells, int threads) {
+  heatmapFree();
+  if (cells < 1)
+    return false;
+  if (cells > HEAT_MAX_CELLS)
+    cells = HEAT_MAX_CELLS;
+
+  double minX, minY, maxX, maxY;
+  if (!figureBoundsGet(bounds, &minX, &minY, &maxX, &maxY))
+    return false;
+  minX -= HEAT_MARGIN;
+  minY -= HEAT_MARGIN;
+  maxX += HEAT_MARGIN;
+  maxY += HEAT_MARGIN;
+
+  double w = maxX - minX, h = maxY - minY;
+  g_cell = (w > h ? w : h) / cells;
+  g_width = (int)ceil(w / g_cell);
+  g_height = (int)ceil(h / g_cell);
+  if (g_width < 1)
+    g_width = 1;
+  if (g_height < 1)
+    g_height = 1;
+  g_x0 = minX;
+  g_y0 = minY;
+  g_counts = calloc((size_t)g_width * g_height, sizeof(uint32_t));
+  if (!g_counts)
+    return false;
+
+  g_threads = threads < 1 ? 1 : threads;
+  if (g_threads > HEAT_MAX_THREADS)
+    g_threads = HEAT_MAX_THREADS;
+  return true;
+}
+
+bool heatmapIsActive(void) { return g_counts != NULL; }
+
+void heatmapAddPolygon(const double *xs, const double *ys, int n) {
+  if (!g_counts || n < 3)
+    return;
+
+  // Só as linhas que o polígono atravessa
+  double minY = ys[0], maxY = ys[0];
+  for (int i = 1; i < n; i++) {
+    if (ys[i] < minY)
+      minY = ys[i];
+    if (ys[i] > maxY)
+      maxY = ys[i];
+  }
+  int rowStart = (int)floor((minY - g_y0) / g_cell);
+  int rowEnd = (int)ceil((maxY - g_y0) / g_cell);
+  if (rowStart < 0)
+    rowStart = 0;
+  if (rowEnd > g_height)
+    rowEnd = g_height;
+  if (rowStart >= rowEnd)
+    return;
+
+  int rows = rowEnd - rowStart;
+  int threads = g_threads;
+  if ((long)rows * n < HEAT_PARALLEL_MIN || rows < threads)
+    threads = 1;
+
+  FillJob jobs[HEAT_MAX_THREADS];
+  double *crossings = malloc(sizeof(double) * n * threads);
+  if (!crossings)
+    return;
+  for (int t = 0; t < threads; t++) {
+    jobs[t].xs = xs;
+    jobs[t].ys = ys;
+    jobs[t].n = n;
+    jobs[t].rowStart = rowStart + (int)((long)rows * t / threads);
+    jobs[t].rowEnd = rowStart + (int)((long)rows * (t + 1) / threads);
+    jobs[t].crossings = crossings + (size_t)n * t;
+  }
+
+  // Faixas de linhas disjuntas: nenhuma célula é tocada por duas threads
+  pthread_t ids[HEAT_MAX_THREADS];
+  int started = 0;
+  for (int t = 1; t < threads; t++) {
+    if (pthread_create(&ids[started], NULL, fillWorker, &jobs[t]) != 0)
+      break;
+    started++;
+  }
+  fillRows(&jobs[0]);
+  // Faixas cujas threads não arrancaram são feitas aqui
+  for (int t = 1 + started; t < threads; t++)
+    fillRows(&jobs[t]);
+  for (int t = 0; t < started; t++)
+    pthread_join(ids[t], NULL);
+  free(crossings);
+}
+
+static FILE *openPgm(const char *stem, const char *suffix, int maxval) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s-%s.pgm", stem, suffix);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return NULL;
+  fprintf(f, "P5\n# x0=%.6f y0=%.6f cell=%.6f\n%d %d\n%d\n", g_x0, g_y0, g_cell,
+          g_width, g_height, maxval);
+  return f;
+}
+
+bool heatmapWrite(const char *stem) {
+  if (!g_counts)
+    return false;
+
+  size_t total = (size_t)g_width * g_height;
+  uint32_t maxCount = 0;
+  for (size_t i = 0; i < total; i++) {
+    if (g_counts[i] > maxCount)
+      maxCount = g_counts[i];
+  }
+
+  unsigned char *row = malloc((size_t)g_width * 2);
+  if (!row)
+    return false;
+
+  // maxval fixo em 65535 para que o PGM use sempre 2 bytes por célula
+  FILE *heat = openPgm(stem, "heat", 255);
+  FILE *count = openPgm(stem, "count", 65535);
+  for (int y = 0; y < g_height && heat && count; y++) {
+    const uint32_t *line = g_counts + (size_t)y * g_width;
+    for (int x = 0; x < g_width; x++)
+      row[x] = maxCount ? (unsigned char)(((uint64_t)line[x] * 255 + maxCount / 2) / maxCount) : 0;
+    fwrite(row, 1, g_width, heat);
+    // PGM de 16 bits: cada valor em big-endian
+    for (int x = 0; x < g_width; x++) {
+      uint32_t v = line[x] > 65535 ? 65535 : line[x];
+      row[2 * x] = (unsigned char)(v >> 8);
+      row[2 * x + 1] = (unsigned char)(v & 0xff);
+    }
+    fwrite(row, 2, g_width, count);
+  }
+
+  bool ok = heat && count;
+  if (heat)
+    fclose(heat);
+  if (count)
+    fclose(count);
+  free(row);
+  return ok;
+}
+
+void heatmapFree(void) {
+  free(g_counts);
+  g_counts = NULL;
+  g_width = g_height = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "figure.h"
+#include <stdbool.h>
+
+/**
+ * @brief Ativa o mapa de cobertura: uma grelha de contadores sobre os limites
+ * atuais da cena (mais uma margem), onde cada polígono de visibilidade soma 1
+ * às células cujo centro cobre. Deve ser chamada depois de lido o .geo.
+ * @param bounds Caixa envolvente da cena.
+ * @param cells Número de células no lado maior da cena.
+ * @param threads Threads usadas no preenchimento das linhas (1 = sequencial).
+ * @return true se a grelha foi criada.
+ */
+bool heatmapInit(FigureBounds bounds, int cells, int threads);
+
+/**
+ * @brief Indica se o mapa de cobertura está ativo.
+ */
+bool heatmapIsActive(void);
+
+/**
+ * @brief Acumula um polígono (regra par-ímpar) no mapa. Sem efeito se o mapa
+ * não estiver ativo.
+ * @param xs Coordenadas X dos vértices.
+ * @param ys Coordenadas Y dos vértices.
+ * @param n Número de vértices.
+ */
+void heatmapAddPolygon(const double *xs, const double *ys, int n);
+
+/**
+ * @brief Escreve o mapa em dois PGM: "<stem>-heat.pgm" (8 bits, normalizado
+ * pela contagem máxima) e "<stem>-count.pgm" (16 bits, as contagens de cada
+ * célula, saturadas em 65535). A origem e o tamanho das células vão num
+ * comentário do cabeçalho.
+ * @param stem Caminho sem extensão.
+ * @return true se ambos os ficheiros foram escritos.
+ */
+bool heatmapWrite(const char *stem);
+
+/**
+ * @brief Liberta o mapa e desativa-o.
+ */
+void heatmapFree(void);
+
+#endif // HEATMAP_H
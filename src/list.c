@@ -1,4 +1,5 @@
 #include "list.h"
+#include "stats.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -13,7 +14,7 @@ typedef struct {
 } list;
 
 List listInit() {
-  list *l = malloc(sizeof(list));
+  list *l = TED_MALLOC(sizeof(list));
   if (!l)
     return NULL;
   l->head = NULL;
@@ -29,9 +30,16 @@ void listFree(List l) {
   while (currentNode != NULL) {
     Node *nodeToFree = currentNode;
     currentNode = currentNode->next;
-    free(nodeToFree);
+    TED_FREE(nodeToFree);
   }
-  free(li);
+  TED_FREE(li);
+}
+
+int listGetSize(List l) {
+  if (!l)
+    return -1;
+  list *li = (list *)l;
+  return li->size;
 }
 
 bool listIsEmpty(List l) {
@@ -45,7 +53,7 @@ bool listAddFirst(List l, void *data) {
   if (!l)
     return false;
   list *li = (list *)l;
-  Node *newNode = malloc(sizeof(Node));
+  Node *newNode = TED_MALLOC(sizeof(Node));
   if (!newNode)
     return false;
   
@@ -70,7 +78,7 @@ bool listAddLast(List l, void *data) {
     if (!l) return false;
     list *li = (list *)l;
     
-    Node *newNode = malloc(sizeof(Node));
+    Node *newNode = TED_MALLOC(sizeof(Node));
     if (!newNode) return false;
     newNode->data = data;
     newNode->next = NULL;
@@ -122,7 +130,7 @@ bool listAddPos(List l, void *data, int pos) {
 
     if (pos == 0) return listAddFirst(l, data);
 
-    Node *newNode = malloc(sizeof(Node));
+    Node *newNode = TED_MALLOC(sizeof(Node));
     if (!newNode) return false;
     newNode->data = data;
 
@@ -136,3 +144,20 @@ bool listAddPos(List l, void *data, int pos) {
     li->size++;
     return true;
 }
+
+void **listToArray(List l, int *size) {
+    if (!l || !size) return NULL;
+    list *li = (list *)l;
+    *size = li->size;
+    if (li->size == 0) return NULL;
+
+    void **items = TED_MALLOC((size_t)li->size * sizeof(void *));
+    if (!items) return NULL;
+
+    // Um único percurso, em vez de listGetPos para cada posição
+    int i = 0;
+    for (Node *aux = li->head; aux != NULL; aux = aux->next) {
+        items[i++] = aux->data;
+    }
+    return items;
+}
@@ -85,4 +85,13 @@ bool listIsEmpty(List l);
  */
 int listGetSize(List l);
 
+/**
+ * @brief Copia os elementos da lista para um vetor, pela ordem da lista.
+ * @param l A lista.
+ * @param size Recebe o número de elementos copiados.
+ * @return O vetor (a libertar com TED_FREE), ou NULL se a lista estiver vazia ou
+ * a alocação falhar.
+ */
+void **listToArray(List l, int *size);
+
 #endif // LINKED_LIST_H
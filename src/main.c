@@ -10,6 +10,19 @@
 #include "qry.h"
 #include "svg.h"
 #include "figure.h"
+#include "pipeline.h"
+#include "vis.h"
+#include "heatmap.h"
+#include "tiles.h"
+#include "stats.h"
+#include "trace.h"
+#include "progress.h"
+#include "tune.h"
+
+// Nível de compressão de -z (o -zl n escolhe outro)
+#define Z_DEFAULT_LEVEL 6
+// Cache de -auto (o -autocache f escolhe outra)
+#define TUNE_DEFAULT_CACHE ".ted-calibracao"
 
 typedef struct {
     char *bed;
@@ -22,6 +35,22 @@ typedef struct {
 
     char sortType;
     int inValue;
+    bool sortGiven;
+    bool inGiven;
+    bool autotune;
+    char *tuneCache;
+    int precision;
+    bool refSuffix;
+    bool async;
+    int threads;
+    int compression;
+    double simplify;
+    int reportFormat;
+    int heatCells;
+    int tileLevels;
+    char *statsPath;
+    char *tracePath;
+    double progress;
 } Config;
 
 static char *getBaseName(const char *filename) {
@@ -60,6 +89,8 @@ void initConfig(Config *config) {
     memset(config, 0, sizeof(Config));
     config->sortType = 'q';
     config->inValue = 10;
+    config->precision = SVG_DEFAULT_PRECISION;
+    config->threads = 1;
 }
 
 void parseArgs(int argc, char *argv[], Config *config) {
@@ -78,9 +109,59 @@ void parseArgs(int argc, char *argv[], Config *config) {
         } 
         else if (strcmp(argv[i], "-to") == 0 && i + 1 < argc) {
             config->sortType = argv[++i][0];
+            config->sortGiven = true;
         } 
         else if (strcmp(argv[i], "-in") == 0 && i + 1 < argc) {
             config->inValue = atoi(argv[++i]);
+            config->inGiven = true;
+        }
+        else if (strcmp(argv[i], "-prec") == 0 && i + 1 < argc) {
+            config->precision = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-ref") == 0) {
+            config->refSuffix = true;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            config->threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-z") == 0) {
+            if (config->compression == 0) config->compression = Z_DEFAULT_LEVEL;
+        }
+        else if (strcmp(argv[i], "-zl") == 0 && i + 1 < argc) {
+            config->compression = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-simp") == 0 && i + 1 < argc) {
+            config->simplify = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-rel") == 0 && i + 1 < argc) {
+            const char *fmt = argv[++i];
+            if (strcmp(fmt, "csv") == 0) config->reportFormat = REPORT_CSV;
+            else if (strcmp(fmt, "bin") == 0) config->reportFormat = REPORT_BIN;
+            else config->reportFormat = REPORT_TEXT;
+        }
+        else if (strcmp(argv[i], "-heat") == 0 && i + 1 < argc) {
+            config->heatCells = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-tiles") == 0 && i + 1 < argc) {
+            config->tileLevels = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-stats") == 0 && i + 1 < argc) {
+            config->statsPath = strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+            config->tracePath = strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-prog") == 0 && i + 1 < argc) {
+            config->progress = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-auto") == 0) {
+            config->autotune = true;
+        }
+        else if (strcmp(argv[i], "-autocache") == 0 && i + 1 < argc) {
+            config->tuneCache = strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-async") == 0) {
+            config->async = true;
         }
     }
 
@@ -101,33 +182,68 @@ void freeConfig(Config *config) {
     if (config->qryName) free(config->qryName);
     if (config->fullGeoPath) free(config->fullGeoPath);
     if (config->fullQryPath) free(config->fullQryPath);
+    if (config->statsPath) free(config->statsPath);
+    if (config->tracePath) free(config->tracePath);
+    if (config->tuneCache) free(config->tuneCache);
 }
 
 int main(int argc, char *argv[]) {
     Config config;
     initConfig(&config);
     parseArgs(argc, argv, &config);
+    svgWriterSetDefaultPrecision(config.precision);
+    qrySetReferenceSuffix(config.refSuffix);
+    svgSetThreads(config.threads);
+    svgWriterSetCompression(config.compression);
+    visSetSimplifyTolerance(config.simplify);
+    // O trace tem de começar antes de qualquer outra thread
+    if (config.tracePath && !traceOpen(config.tracePath)) {
+        fprintf(stderr, "ERRO: Não foi possível criar o ficheiro de trace: %s\n", config.tracePath);
+    }
+    // Escrita dos ficheiros numa thread à parte; sem ela tudo é síncrono.
+    // A compressão também corre nessa thread.
+    if ((config.async || config.compression > 0) && !pipelineStart()) {
+        fprintf(stderr, "AVISO: Não foi possível iniciar a thread de escrita\n");
+    }
+
+    // Contadores e tempos por comando, escritos no fim da execução
+    if (config.statsPath) {
+        if (!STATS_ENABLED) {
+            fprintf(stderr, "AVISO: -stats ignorado (compilado com STATS=0)\n");
+        } else if (!statsOpen(config.statsPath)) {
+            fprintf(stderr, "ERRO: Não foi possível criar o ficheiro de estatísticas: %s\n", config.statsPath);
+        }
+    }
 
     List figures = listInit();
-    if (!figures) {
+    FigureBounds bounds = figureBoundsInit();
+    if (!figures || !bounds) {
+        if (figures) listFree(figures);
+        figureBoundsFree(bounds);
         freeConfig(&config);
         return 1;
     }
 
-    processGeoFile(config.fullGeoPath, figures);
+    traceBegin("ler .geo", "io");
+    statsCommandBegin();
+    processGeoFile(config.fullGeoPath, figures, bounds);
+    statsPhaseEnd("leitura");
+    traceEnd();
 
     char *geoStem = getBaseName(config.geoName);
     char svgName[256];
     sprintf(svgName, "%s.svg", geoStem);
     char *fullSvgPath = joinPath(config.bsd, svgName);
 
-    FILE *fSvg = fopen(fullSvgPath, "w");
+    statsCommandBegin();
+    SvgWriter fSvg = svgWriterOpen(fullSvgPath);
     if (fSvg) {
         svgInit(fSvg);
         svgDrawAll(fSvg, figures);
         svgClose(fSvg);
-        fclose(fSvg);
+        svgWriterClose(fSvg);
     }
+    statsPhaseEnd("desenho");
     
     free(fullSvgPath);
 
@@ -136,22 +252,85 @@ int main(int argc, char *argv[]) {
         
         char mergedName[512];
         sprintf(mergedName, "%s-%s.svg", geoStem, qryStem);
+        // O relatório em CSV ou binário converte-se no TXT com tools/report2txt
+        const char *txtExt = "txt";
+        if (config.reportFormat == REPORT_CSV) txtExt = "csv";
+        else if (config.reportFormat == REPORT_BIN) txtExt = "rep";
         char txt[512];
-        sprintf(txt,"%s-%s.txt",geoStem,qryStem);
+        sprintf(txt,"%s-%s.%s",geoStem,qryStem,txtExt);
         
         char *fullTxtPath = joinPath(config.bsd, txt); 
         char *fullQryOutPath = joinPath(config.bsd, mergedName);
         
-        FILE *txtFile = fopen(fullTxtPath, "w"); 
+        // Calibração de -to/-in na cena lida; o que foi dado na linha de
+        // comando prevalece. Tem de vir antes do mapa de cobertura, que
+        // acumularia as regiões medidas.
+        if (config.autotune && !(config.sortGiven && config.inGiven)) {
+            traceBegin("calibração", "tune");
+            statsCommandBegin();
+            char sortType;
+            int inValue;
+            const char *cache = config.tuneCache ? config.tuneCache : TUNE_DEFAULT_CACHE;
+            // Só são medidas as combinações com o que foi fixado
+            bool cached = tuneChoose(figures, bounds, cache, config.sortGiven ? config.sortType : 0,
+                                     config.inGiven ? config.inValue : 0, &sortType, &inValue);
+            config.sortType = sortType;
+            config.inValue = inValue;
+            fprintf(stderr, "calibração: -to %c -in %d (%s)\n", config.sortType, config.inValue,
+                    cached ? "cache" : "medido");
+            statsPhaseEnd("calibracao");
+            traceEnd();
+        }
+
+        // Mapa de cobertura sobre a cena lida do .geo
+        if (config.heatCells > 0 && !heatmapInit(bounds, config.heatCells, config.threads)) {
+            fprintf(stderr, "AVISO: Não foi possível criar o mapa de cobertura\n");
+        }
+
+        // Tiles do .qry: a cena inicial é escrita já, o resto à medida dos comandos
+        if (config.tileLevels > 0) {
+            char tileName[512];
+            sprintf(tileName, "%s-%s", geoStem, qryStem);
+            char *tileStem = joinPath(config.bsd, tileName);
+            if (tilesInit(tileStem, bounds, config.tileLevels, config.threads)) {
+                tilesUpdate(figures);
+            } else {
+                fprintf(stderr, "AVISO: Não foi possível ativar a saída em tiles\n");
+            }
+            free(tileStem);
+        }
+
+        // Progresso do .qry no stderr a cada config.progress segundos
+        if (config.progress > 0 && !progressStart(config.progress)) {
+            fprintf(stderr, "AVISO: Não foi possível iniciar a thread de progresso\n");
+        }
+
+        traceBegin("processQry", "qry");
+        Report report = reportOpen(fullTxtPath, config.reportFormat); 
         
-        if (txtFile) {
-            processQry(config.fullQryPath, fullQryOutPath, figures, config.sortType, config.inValue, txtFile);
-            fclose(txtFile);
+        if (report) {
+            processQry(config.fullQryPath, fullQryOutPath, figures, bounds, config.sortType, config.inValue, report);
+            reportClose(report);
         } else {
             fprintf(stderr, "ERRO: Não foi possível abrir o arquivo de log TXT em: %s\n", fullTxtPath);
-            processQry(config.fullQryPath, fullQryOutPath, figures, config.sortType, config.inValue, NULL);
+            processQry(config.fullQryPath, fullQryOutPath, figures, bounds, config.sortType, config.inValue, NULL);
         }
+        traceEnd();
+        progressStop();
         
+        if (heatmapIsActive()) {
+            char heatName[512];
+            sprintf(heatName, "%s-%s", geoStem, qryStem);
+            char *heatStem = joinPath(config.bsd, heatName);
+            if (!heatmapWrite(heatStem)) {
+                fprintf(stderr, "ERRO: Não foi possível escrever o mapa de cobertura em: %s\n", heatStem);
+            }
+            free(heatStem);
+            heatmapFree();
+        }
+
+        tilesFree();
+
         free(qryStem);
         free(fullQryOutPath);
         free(fullTxtPath);
@@ -165,7 +344,11 @@ int main(int argc, char *argv[]) {
         figureFree(fig);
     }
     listFree(figures);
+    figureBoundsFree(bounds);
 
+    statsClose();
+    pipelineStop();
+    traceClose();
     freeConfig(&config);
     return 0;
 }
@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+#include "trace.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <zlib.h>
+
+// Capacidade da fila cálculo -> escrita (limita os buffers em trânsito)
+#define PIPE_QUEUE_SIZE 64
+// Capacidade da fila de buffers devolvidos; se encher, o buffer é libertado
+#define PIPE_FREE_SIZE (2 * PIPE_QUEUE_SIZE)
+// Buffers de reserva do lado do cálculo (só acedidos por essa thread)
+#define PIPE_SPARE_SIZE 8
+
+#define MSG_WRITE 1
+#define MSG_CLOSE 2
+#define MSG_STOP 3
+
+// Com gz, a compressão também corre na thread de escrita
+typedef struct {
+  FILE *file;
+  gzFile gz;
+  bool ownsFile;
+} Channel;
+
+typedef struct {
+  int type;
+  Channel *ch;
+  char *data;
+  size_t len;
+} Message;
+
+// Fila SPSC: o produtor só escreve tail e o consumidor só escreve head. Os
+// semáforos servem apenas para adormecer quando a fila está cheia ou vazia.
+typedef struct {
+  Message slots[PIPE_QUEUE_SIZE];
+  atomic_size_t head;
+  atomic_size_t tail;
+  sem_t items;
+  sem_t spaces;
+} MessageQueue;
+
+// Fila SPSC sem bloqueio para devolver buffers (escrita -> cálculo)
+typedef struct {
+  char *slots[PIPE_FREE_SIZE];
+  atomic_size_t head;
+  atomic_size_t tail;
+} BufferQueue;
+
+static MessageQueue g_queue;
+static char *g_spare[PIPE_SPARE_SIZE];
+static int g_spareCount = 0;
+static BufferQueue g_free;
+static pthread_t g_thread;
+static bool g_active = false;
+
+// --- Filas ---
+
+static void queuePush(Message m) {
+  sem_wait(&g_queue.spaces);
+  size_t tail = atomic_load_explicit(&g_queue.tail, memory_order_relaxed);
+  g_queue.slots[tail % PIPE_QUEUE_SIZE] = m;
+  atomic_store_explicit(&g_queue.tail, tail + 1, memory_order_release);
+  sem_post(&g_queue.items);
+}
+
+static Message queuePop(void) {
+  sem_wait(&g_queue.items);
+  size_t head = atomic_load_explicit(&g_queue.head, memory_order_relaxed);
+  Message m = g_queue.slots[head % PIPE_QUEUE_SIZE];
+  atomic_store_explicit(&g_queue.head, head + 1, memory_order_release);
+  sem_post(&g_queue.spaces);
+  return m;
+}
+
+static void freePush(char *buffer) {
+  size_t tail = atomic_load_explicit(&g_free.tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&g_free.head, memory_order_acquire);
+  if (tail - head >= PIPE_FREE_SIZE) {
+    free(buffer);
+    return;
+  }
+  g_free.slots[tail % PIPE_FREE_SIZE] = buffer;
+  atomic_store_explicit(&g_free.tail, tail + 1, memory_order_release);
+}
+
+static char *freePop(void) {
+  size_t head = atomic_load_explicit(&g_free.head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&g_free.tail, memory_order_acquire);
+  if (head == tail)
+    return NULL;
+  char *buffer = g_free.slots[head % PIPE_FREE_SIZE];
+  atomic_store_explicit(&g_free.head, head + 1, memory_order_release);
+  return buffer;
+}
+
+// --- Thread de Escrita ---
+
+static void *writerThread(void *arg) {
+  (void)arg;
+  traceSetThreadName("escrita");
+  for (;;) {
+    Message m = queuePop();
+    Channel *ch = m.ch;
+    switch (m.type) {
+    case MSG_WRITE:
+      traceBeginArg("gravar", "io", "bytes", (long)m.len);
+      if (ch->gz)
+        gzwrite(ch->gz, m.data, (unsigned)m.len);
+      else if (ch->file)
+        fwrite(m.data, 1, m.len, ch->file);
+      traceEnd();
+      freePush(m.data);
+      break;
+    case MSG_CLOSE:
+      if (ch->gz) {
+        gzclose(ch->gz);
+      } else if (ch->file) {
+        if (ch->ownsFile)
+          fclose(ch->file);
+        else
+          fflush(ch->file);
+      }
+      free(ch);
+      break;
+    case MSG_STOP:
+      return NULL;
+    }
+  }
+}
+
+bool pipelineStart(void) {
+  if (g_active)
+    return true;
+  atomic_init(&g_queue.head, 0);
+  atomic_init(&g_queue.tail, 0);
+  atomic_init(&g_free.head, 0);
+  atomic_init(&g_free.tail, 0);
+  sem_init(&g_queue.items, 0, 0);
+  sem_init(&g_queue.spaces, 0, PIPE_QUEUE_SIZE);
+  if (pthread_create(&g_thread, NULL, writerThread, NULL) != 0) {
+    sem_destroy(&g_queue.items);
+    sem_destroy(&g_queue.spaces);
+    return false;
+  }
+  g_active = true;
+  return true;
+}
+
+void pipelineStop(void) {
+  if (!g_active)
+    return;
+  Message m = {MSG_STOP, NULL, NULL, 0};
+  queuePush(m);
+  pthread_join(g_thread, NULL);
+  g_active = false;
+
+  char *buffer;
+  while ((buffer = freePop()) != NULL)
+    free(buffer);
+  while (g_spareCount > 0)
+    free(g_spare[--g_spareCount]);
+  sem_destroy(&g_queue.items);
+  sem_destroy(&g_queue.spaces);
+}
+
+bool pipelineIsActive(void) { return g_active; }
+
+PipeChannel pipelineOpen(FILE *file, gzFile gz, bool ownsFile) {
+  Channel *ch = malloc(sizeof(Channel));
+  if (!ch)
+    return NULL;
+  ch->file = file;
+  ch->gz = gz;
+  ch->ownsFile = ownsFile;
+  return (PipeChannel)ch;
+}
+
+char *pipelineAcquireBuffer(void) {
+  if (g_spareCount > 0)
+    return g_spare[--g_spareCount];
+  char *buffer = freePop();
+  if (buffer)
+    return buffer;
+  return malloc(PIPELINE_BUFFER_SIZE);
+}
+
+char *pipelineAwaitBuffer(void) {
+  char *buffer = pipelineAcquireBuffer();
+  // Só falha sem memória; espera que a thread de escrita devolva um buffer
+  struct timespec pause = {0, 100000};
+  while (!buffer) {
+    nanosleep(&pause, NULL);
+    buffer = freePop();
+  }
+  return buffer;
+}
+
+void pipelineReleaseBuffer(char *buffer) {
+  if (g_spareCount < PIPE_SPARE_SIZE)
+    g_spare[g_spareCount++] = buffer;
+  else
+    free(buffer);
+}
+
+void pipelineSubmit(PipeChannel ch, char *buffer, size_t len) {
+  Message m = {MSG_WRITE, (Channel *)ch, buffer, len};
+  queuePush(m);
+}
+
+void pipelineClose(PipeChannel ch) {
+  Message m = {MSG_CLOSE, (Channel *)ch, NULL, 0};
+  queuePush(m);
+}
@@ -0,0 +1,85 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <zlib.h>
+
+/**
+ * @brief Tamanho fixo de cada buffer que circula entre o cálculo e a thread
+ * de escrita.
+ */
+#define PIPELINE_BUFFER_SIZE (256 * 1024)
+
+/**
+ * @brief Tipo opaco para um ficheiro de saída gerido pela thread de escrita.
+ */
+typedef void *PipeChannel;
+
+/**
+ * @brief Inicia a thread de escrita. A partir daqui os SvgWriter de ficheiro
+ * entregam os seus buffers à thread em vez de escreverem diretamente.
+ * @return true se a thread foi criada (ou já estava ativa).
+ */
+bool pipelineStart(void);
+
+/**
+ * @brief Espera que todas as mensagens pendentes sejam escritas e termina a
+ * thread de escrita.
+ */
+void pipelineStop(void);
+
+/**
+ * @brief Indica se a thread de escrita está ativa.
+ */
+bool pipelineIsActive(void);
+
+/**
+ * @brief Entrega à thread de escrita um ficheiro já aberto por quem chama
+ * (assim os erros de abertura chegam a quem abre). A partir daqui só a thread
+ * de escrita lhe toca.
+ * @param file Ficheiro de texto, ou NULL se gz for dado.
+ * @param gz Ficheiro gzip, cuja compressão corre na thread de escrita, ou NULL.
+ * @param ownsFile true para fechar file no fim (gz é sempre fechado).
+ * @return O canal, ou NULL se a alocação falhar.
+ */
+PipeChannel pipelineOpen(FILE *file, gzFile gz, bool ownsFile);
+
+/**
+ * @brief Obtém um buffer livre de PIPELINE_BUFFER_SIZE bytes.
+ * @return O buffer, ou NULL se a alocação falhar.
+ */
+char *pipelineAcquireBuffer(void);
+
+/**
+ * @brief Como pipelineAcquireBuffer, mas sem memória para um buffer novo
+ * espera que a thread de escrita devolva um. Só deve ser chamada com pelo
+ * menos um buffer já entregue.
+ * @return O buffer.
+ */
+char *pipelineAwaitBuffer(void);
+
+/**
+ * @brief Entrega um buffer cheio à thread de escrita, que o devolve ao pool
+ * depois de o escrever. A ordem de escrita é a ordem das chamadas.
+ * @param ch O canal.
+ * @param buffer O buffer (obtido com pipelineAcquireBuffer).
+ * @param len Bytes válidos no buffer.
+ */
+void pipelineSubmit(PipeChannel ch, char *buffer, size_t len);
+
+/**
+ * @brief Pede o fecho do canal depois das escritas já entregues. O canal
+ * deixa de ser válido para quem chama.
+ * @param ch O canal.
+ */
+void pipelineClose(PipeChannel ch);
+
+/**
+ * @brief Devolve ao pool um buffer que não chegou a ser entregue.
+ * @param buffer O buffer.
+ */
+void pipelineReleaseBuffer(char *buffer);
+
+#endif // PIPELINE_H
@@ -0,0 +1,39 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/**
+ * @brief Pontos de prova estáticos (USDT, provider "ted") para perf e
+ * bpftrace; ver tools/bpftrace/. Com <sys/sdt.h> disponível (pacote
+ * systemtap-sdt-dev) cada prova é um nop mais uma nota ELF e não custa nada
+ * sem um tracer ligado. Sem o cabeçalho, ou com make PROBES=0, as macros não
+ * geram código nem avaliam os argumentos.
+ *
+ * O bpftrace não lê doubles, por isso as coordenadas e raios vão em
+ * milésimos (TED_MILLI).
+ */
+
+#if !defined(TED_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TED_HAVE_PROBES 1
+#endif
+#endif
+
+#define TED_MILLI(v) ((long)((v) * 1000.0))
+
+#ifdef TED_HAVE_PROBES
+#define TED_PROBE1(name, a) DTRACE_PROBE1(ted, name, a)
+#define TED_PROBE2(name, a, b) DTRACE_PROBE2(ted, name, a, b)
+#define TED_PROBE3(name, a, b, c) DTRACE_PROBE3(ted, name, a, b, c)
+#define TED_PROBE4(name, a, b, c, d) DTRACE_PROBE4(ted, name, a, b, c, d)
+#else
+// sizeof não avalia os argumentos, mas conta como uso (sem avisos de
+// variáveis ou parâmetros não usados)
+#define TED_PROBE1(name, a) ((void)sizeof(a))
+#define TED_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define TED_PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#define TED_PROBE4(name, a, b, c, d)                                           \
+  ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c), (void)sizeof(d))
+#endif
+
+#endif // PROBES_H
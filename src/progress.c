@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "progress.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+static bool g_active = false;
+static bool g_stopping = false;
+static double g_interval;
+static struct timespec g_origin;
+static pthread_t g_thread;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake;
+
+// Escritos só pela thread de cálculo, lidos pela do progresso
+static atomic_long g_done;
+static atomic_long g_total;
+static atomic_long g_figures;
+
+static double elapsedSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec - g_origin.tv_sec) + (ts.tv_nsec - g_origin.tv_nsec) / 1.0e9;
+}
+
+// Memória residente em MiB, de /proc/self/statm (0 se não houver)
+static double residentMiB(void) {
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  long size, resident = 0;
+  if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+    resident = 0;
+  fclose(f);
+  return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+static void formatDuration(double seconds, char *dest, size_t size) {
+  long s = (long)(seconds + 0.5);
+  if (s >= 3600)
+    snprintf(dest, size, "%ldh%02ldm%02lds", s / 3600, (s / 60) % 60, s % 60);
+  else if (s >= 60)
+    snprintf(dest, size, "%ldm%02lds", s / 60, s % 60);
+  else
+    snprintf(dest, size, "%lds", s);
+}
+
+// rate é a média desde a linha anterior; a estimativa usa a média global
+static void printLine(long done, double rate, double elapsed, bool last) {
+  long total = atomic_load_explicit(&g_total, memory_order_relaxed);
+  long figures = atomic_load_explicit(&g_figures, memory_order_relaxed);
+  char when[32], eta[48] = "";
+  formatDuration(elapsed, when, sizeof(when));
+  if (total > 0 && !last) {
+    char left[32] = "?";
+    if (done > 0)
+      formatDuration((total - done) * elapsed / done, left, sizeof(left));
+    snprintf(eta, sizeof(eta), " (%.1f%%), faltam %s", 100.0 * done / total, left);
+  }
+  fprintf(stderr, "[%s] %ld%s%ld comandos%s, %.1f cmd/s, %ld figuras, %.1f MiB residentes\n",
+          when, done, total > 0 ? "/" : "", total > 0 ? total : 0, eta, rate, figures,
+          residentMiB());
+}
+
+static void *progressThread(void *arg) {
+  (void)arg;
+  long lastDone = 0;
+  double lastTime = 0;
+  pthread_mutex_lock(&g_lock);
+  while (!g_stopping) {
+    struct timespec wake;
+    clock_gettime(CLOCK_MONOTONIC, &wake);
+    long long ns = wake.tv_nsec + (long long)(g_interval * 1.0e9);
+    wake.tv_sec += ns / 1000000000LL;
+    wake.tv_nsec = ns % 1000000000LL;
+    // Acordares espúrios não contam; progressStop acorda com g_stopping
+    while (!g_stopping && pthread_cond_timedwait(&g_wake, &g_lock, &wake) != ETIMEDOUT)
+      ;
+    if (g_stopping)
+      break;
+    long done = atomic_load_explicit(&g_done, memory_order_relaxed);
+    double now = elapsedSeconds();
+    printLine(done, now > lastTime ? (done - lastDone) / (now - lastTime) : 0, now, false);
+    lastDone = done;
+    lastTime = now;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+bool progressStart(double interval) {
+  if (g_active)
+    return true;
+  if (interval <= 0)
+    return false;
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_wake, &attr);
+  pthread_condattr_destroy(&attr);
+  g_interval = interval;
+  g_stopping = false;
+  atomic_init(&g_done, 0);
+  atomic_init(&g_total, 0);
+  atomic_init(&g_figures, 0);
+  clock_gettime(CLOCK_MONOTONIC, &g_origin);
+  if (pthread_create(&g_thread, NULL, progressThread, NULL) != 0) {
+    pthread_cond_destroy(&g_wake);
+    return false;
+  }
+  g_active = true;
+  return true;
+}
+
+bool progressIsActive(void) { return g_active; }
+
+void progressSetTotal(long commands) {
+  if (g_active)
+    atomic_store_explicit(&g_total, commands, memory_order_relaxed);
+}
+
+void progressCommandDone(long figures) {
+  if (!g_active)
+    return;
+  atomic_store_explicit(&g_done, atomic_load_explicit(&g_done, memory_order_relaxed) + 1,
+                        memory_order_relaxed);
+  atomic_store_explicit(&g_figures, figures, memory_order_relaxed);
+}
+
+void progressStop(void) {
+  if (!g_active)
+    return;
+  pthread_mutex_lock(&g_lock);
+  g_stopping = true;
+  pthread_cond_signal(&g_wake);
+  pthread_mutex_unlock(&g_lock);
+  pthread_join(g_thread, NULL);
+  g_active = false;
+  pthread_cond_destroy(&g_wake);
+
+  long done = atomic_load_explicit(&g_done, memory_order_relaxed);
+  double elapsed = elapsedSeconds();
+  printLine(done, elapsed > 0 ? done / elapsed : 0, elapsed, true);
+}
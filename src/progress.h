@@ -0,0 +1,39 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Inicia a thread que escreve o progresso do .qry no stderr a cada
+ * interval segundos: comandos feitos, comandos por segundo, tempo estimado
+ * até ao fim, figuras na cena e memória residente. A thread só lê contadores
+ * atómicos, sem nunca bloquear o cálculo.
+ * @param interval Segundos entre linhas (> 0).
+ * @return false se a thread não puder ser criada.
+ */
+bool progressStart(double interval);
+
+/**
+ * @brief Indica se o progresso está ativo.
+ */
+bool progressIsActive(void);
+
+/**
+ * @brief Define o número total de comandos, usado na estimativa do tempo
+ * restante (0 se desconhecido).
+ */
+void progressSetTotal(long commands);
+
+/**
+ * @brief Marca mais um comando concluído. Só deve ser chamada pela thread de
+ * cálculo.
+ * @param figures Número de figuras na cena depois do comando.
+ */
+void progressCommandDone(long figures);
+
+/**
+ * @brief Escreve a linha final e termina a thread.
+ */
+void progressStop(void);
+
+#endif // PROGRESS_H
@@ -3,16 +3,29 @@
 #include "svg.h"
 #include "figure.h"
 #include "list.h"
+#include "report.h"
+#include "tiles.h"
+#include "stats.h"
+#include "trace.h"
+#include "probes.h"
+#include "progress.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdbool.h>
 
-// Definindo POLYGON como 5, um valor comum em figure.h para este tipo de projeto.
-#ifndef POLYGON
-#define POLYGON 5
-#endif
+// Meia largura do marcador das bombas (raio 5 mais o contorno)
+#define MARKER_EXTENT 6.0
+// Tamanho da etiqueta "CLN" (o da fonte por omissão do SVG)
+#define CLN_FONT_SIZE 16.0
+
+// Modo de referência: os arquivos de sufixo usam <use> sobre um SVG base
+// partilhado, escrito uma vez por versão da cena
+static bool g_refSuffix = false;
+static unsigned long g_baseVersion = 0;
+static bool g_hasBase = false;
+static char g_baseName[512];
 
 // --- Funções Auxiliares ---
 
@@ -25,15 +38,85 @@ static void makeSvgPathWithSuffix(const char *basePath, const char *sfx, char *d
     strcat(dest, ".svg");
 }
 
-static const char* getShapeName(int shape) {
-    switch (shape) {
-        case CIRCLE: return "CIRCULO";
-        case RECTANGLE: return "RETANGULO";
-        case LINE: return "LINHA";
-        case TEXT: return "TEXTO";
-        case POLYGON: return "POLIGONO"; 
-        default: return "DESCONHECIDO";
+void qrySetReferenceSuffix(bool enabled) {
+    g_refSuffix = enabled;
+    g_hasBase = false;
+}
+
+// Garante que existe um SVG base com o estado atual da cena e devolve o seu
+// nome (relativo, pois fica na mesma diretoria dos arquivos de sufixo)
+static const char *ensureBaseSvg(const char *baseOutPath, List figures) {
+    unsigned long version = figureSceneVersion();
+    if (g_hasBase && g_baseVersion == version) return g_baseName;
+
+    // "<saida>.base-N.svg": os arquivos de sufixo são sempre "<saida>-sfx.svg",
+    // por isso nenhum sufixo do .qry coincide com uma base
+    char basePath[512];
+    strcpy(basePath, baseOutPath);
+    char *dot = strrchr(basePath, '.');
+    if (dot) *dot = '\0';
+    sprintf(basePath + strlen(basePath), ".base-%lu.svg", version);
+
+    SvgWriter base = svgWriterOpen(basePath);
+    if (!base) return NULL;
+    svgInit(base);
+    svgWriteStr(base, "<g id=\"scene\">\n");
+    svgDrawAll(base, figures);
+    svgWriteStr(base, "</g>\n");
+    svgClose(base);
+    svgWriterClose(base);
+
+    // O href tem de apontar para o ficheiro efetivo (.svgz com compressão)
+    char actualPath[512];
+    svgWriterOutputPath(basePath, actualPath, sizeof(actualPath));
+    const char *slash = strrchr(actualPath, '/');
+    strcpy(g_baseName, slash ? slash + 1 : actualPath);
+    g_baseVersion = version;
+    g_hasBase = true;
+    return g_baseName;
+}
+
+// Abre o arquivo de sufixo já com o cabeçalho e a cena (completa ou por referência)
+static SvgWriter openSuffixSvg(const char *baseOutPath, const char *sfx, List figures) {
+    const char *baseName = NULL;
+    if (g_refSuffix) baseName = ensureBaseSvg(baseOutPath, figures);
+
+    char auxSvgPath[512];
+    makeSvgPathWithSuffix(baseOutPath, sfx, auxSvgPath);
+    SvgWriter svg = svgWriterOpen(auxSvgPath);
+    if (!svg) return NULL;
+    svgInit(svg);
+    if (baseName) svgWritef(svg, "\t<use href=\"%s#scene\" />\n", baseName);
+    else svgDrawAll(svg, figures);
+    return svg;
+}
+
+// Com os tiles ativos, o marcador e o polígono de um comando são escritos
+// primeiro num buffer, para irem também para os tiles
+static SvgWriter beginOverlay(SvgWriter target) {
+    if (!tilesIsActive()) return target;
+    SvgWriter overlay = svgWriterInitMemory();
+    if (!overlay) return target;
+    svgWriterSetPrecision(overlay, svgWriterGetPrecision(target));
+    return overlay;
+}
+
+// Copia a sobreposição para o SVG de destino e regista-a nos tiles. A caixa
+// é a do marcador, mais a do polígono se houver.
+static void endOverlay(SvgWriter overlay, SvgWriter target, double minX, double minY,
+                       double maxX, double maxY, bool hasRegion) {
+    if (overlay == target) return;
+    if (hasRegion) {
+        double rx1, ry1, rx2, ry2;
+        visGetLastRegionBounds(&rx1, &ry1, &rx2, &ry2);
+        minX = fmin(minX, rx1); minY = fmin(minY, ry1);
+        maxX = fmax(maxX, rx2); maxY = fmax(maxY, ry2);
     }
+    size_t len;
+    const char *data = svgWriterData(overlay, &len);
+    svgWriteBytes(target, data, len);
+    tilesAddOverlay(data, len, minX, minY, maxX, maxY);
+    svgWriterClose(overlay);
 }
 
 static void getFigureCenter(Figure f, double *x, double *y) {
@@ -48,7 +131,7 @@ static void getFigureCenter(Figure f, double *x, double *y) {
 
 // --- Comandos ---
 
-static void processA(const char *params, List figures, FILE *txtFile) {
+static void processA(const char *params, List figures, FigureBounds bounds, Report report) {
     int idStart, idEnd;
     char orient; 
     
@@ -87,10 +170,14 @@ static void processA(const char *params, List figures, FILE *txtFile) {
                 setLine(seg, newId, x1, y1, x2, y2, cb);
                 listAddLast(newLines, seg);
 
-                if (txtFile) {
+                if (report) {
                     // LOG A: reportar id e tipo da figura original, id e extremos dos segmentos produzidos
-                    fprintf(txtFile, "A: Figura Original ID %d (%s) -> Segmento Novo ID %d. Extremos: (%.1f, %.1f) e (%.1f, %.1f). Cor: %s\n",
-                            figId, getShapeName(shape), newId, x1, y1, x2, y2, cb);
+                    ReportRecord rec;
+                    reportRecordInit(&rec, REPORT_OP_A, figId, shape);
+                    rec.newId = newId;
+                    rec.v[0] = x1; rec.v[1] = y1; rec.v[2] = x2; rec.v[3] = y2;
+                    snprintf(rec.color, sizeof(rec.color), "%s", cb);
+                    reportAdd(report, &rec);
                 }
                 
                 // "Destroi" o círculo original APÓS pegar as informações para o log
@@ -102,31 +189,31 @@ static void processA(const char *params, List figures, FILE *txtFile) {
     i = 0;
     while ((data = listGetPos(newLines, i++))) {
         listAddLast(figures, data);
+        figureBoundsAdd(bounds, data);
     }
     listFree(newLines);
 }
 
-static void processD(const char *params, List figures, FILE *mainSvg, const char *baseOutPath, char sortType, int sortThreshold, FILE *txtFile) {
+static void processD(const char *params, List figures, FigureBounds bounds, SvgWriter mainSvg, const char *baseOutPath, char sortType, int sortThreshold, Report report) {
     double x, y;
     char sfx[64];
     
     if (sscanf(params, "%lf %lf %s", &x, &y, sfx) < 3) return;
 
-    FILE *targetSvg = mainSvg;
+    SvgWriter targetSvg = mainSvg;
     bool isSeparateFile = (strcmp(sfx, "-") != 0);
-    char auxSvgPath[512];
 
     if (isSeparateFile) {
-        makeSvgPathWithSuffix(baseOutPath, sfx, auxSvgPath);
-        targetSvg = fopen(auxSvgPath, "w");
+        targetSvg = openSuffixSvg(baseOutPath, sfx, figures);
         if (!targetSvg) return;
-        svgInit(targetSvg);
-        svgDrawAll(targetSvg, figures);
     }
 
-    fprintf(targetSvg, "\t<circle cx=\"%lf\" cy=\"%lf\" r=\"5\" fill=\"red\" stroke=\"black\" stroke-width=\"2\" />\n", x, y);
+    SvgWriter overlay = beginOverlay(targetSvg);
+    svgWritef(overlay, "\t<circle cx=\"%f\" cy=\"%f\" r=\"5\" fill=\"red\" stroke=\"black\" stroke-width=\"2\" />\n", x, y);
     // Chamada para desenhar o polígono (região de visibilidade)
-    visDrawRegion(figures, x, y, targetSvg, sortType, sortThreshold); 
+    visDrawRegion(figures, bounds, x, y, overlay, sortType, sortThreshold); 
+    endOverlay(overlay, targetSvg, x - MARKER_EXTENT, y - MARKER_EXTENT,
+               x + MARKER_EXTENT, y + MARKER_EXTENT, true);
 
     int i = 0;
     void *data;
@@ -141,13 +228,15 @@ static void processD(const char *params, List figures, FILE *mainSvg, const char
         if (getFigureShape(f) == LINE) continue; 
 
         // Checar se o centro da figura está dentro do polígono de visibilidade
-        if (visIsVisible(figures, x, y, fx, fy)) {
+        if (visIsVisible(figures, bounds, x, y, fx, fy)) {
             int id = getFigureId(f);
             int shape = getFigureShape(f);
             
-            if (txtFile) {
+            if (report) {
                 // LOG D: reportar id e tipo das formas destruídas
-                fprintf(txtFile, "D: Figura destruída ID=%d Tipo=%s\n", id, getShapeName(shape));
+                ReportRecord rec;
+                reportRecordInit(&rec, REPORT_OP_D, id, shape);
+                reportAdd(report, &rec);
             }
             // Destroi a figura
             if (shape == CIRCLE) setCircle(f, id, fx, fy, 0.0, "none", "none");
@@ -157,11 +246,11 @@ static void processD(const char *params, List figures, FILE *mainSvg, const char
 
     if (isSeparateFile) {
         svgClose(targetSvg);
-        fclose(targetSvg);
+        svgWriterClose(targetSvg);
     }
 }
 
-static void processP(const char *params, List figures, FILE *mainSvg, const char *baseOutPath, char sortType, int sortThreshold, FILE *txtFile) {
+static void processP(const char *params, List figures, FigureBounds bounds, SvgWriter mainSvg, const char *baseOutPath, char sortType, int sortThreshold, Report report) {
     double x, y;
     char color[32];
     char sfx[64];
@@ -170,21 +259,20 @@ static void processP(const char *params, List figures, FILE *mainSvg, const char
     if (read < 3) return; 
     if (read == 3) strcpy(sfx, "-");
 
-    FILE *targetSvg = mainSvg;
+    SvgWriter targetSvg = mainSvg;
     bool isSeparateFile = (strcmp(sfx, "-") != 0);
-    char auxSvgPath[512];
 
     if (isSeparateFile) {
-        makeSvgPathWithSuffix(baseOutPath, sfx, auxSvgPath);
-        targetSvg = fopen(auxSvgPath, "w");
+        targetSvg = openSuffixSvg(baseOutPath, sfx, figures);
         if (!targetSvg) return;
-        svgInit(targetSvg);
-        svgDrawAll(targetSvg, figures);
     }
 
-    fprintf(targetSvg, "\t<circle cx=\"%lf\" cy=\"%lf\" r=\"5\" fill=\"%s\" stroke=\"black\" opacity=\"1\" />\n", x, y, color);
+    SvgWriter overlay = beginOverlay(targetSvg);
+    svgWritef(overlay, "\t<circle cx=\"%f\" cy=\"%f\" r=\"5\" fill=\"%s\" stroke=\"black\" opacity=\"1\" />\n", x, y, color);
     // Chamada para desenhar o polígono (região de visibilidade)
-    visDrawRegion(figures, x, y, targetSvg, sortType, sortThreshold);
+    visDrawRegion(figures, bounds, x, y, overlay, sortType, sortThreshold);
+    endOverlay(overlay, targetSvg, x - MARKER_EXTENT, y - MARKER_EXTENT,
+               x + MARKER_EXTENT, y + MARKER_EXTENT, true);
 
     int i = 0;
     void *data;
@@ -199,27 +287,30 @@ static void processP(const char *params, List figures, FILE *mainSvg, const char
         if (getFigureShape(f) == LINE) continue; 
 
         // Checar se o centro da figura está dentro do polígono de visibilidade
-        if (visIsVisible(figures, x, y, fx, fy)) {
+        if (visIsVisible(figures, bounds, x, y, fx, fy)) {
             int id = getFigureId(f);
             int shape = getFigureShape(f);
             
             // Pintar a figura
             putFigureColor(f, color, color);
             
-            if (txtFile) {
+            if (report) {
                 // LOG P: reportar id e tipo das formas pintadas
-                fprintf(txtFile, "P: Figura pintada ID=%d Tipo=%s Cor=%s\n", id, getShapeName(shape), color);
+                ReportRecord rec;
+                reportRecordInit(&rec, REPORT_OP_P, id, shape);
+                snprintf(rec.color, sizeof(rec.color), "%s", color);
+                reportAdd(report, &rec);
             }
         }
     }
 
     if (isSeparateFile) {
         svgClose(targetSvg);
-        fclose(targetSvg);
+        svgWriterClose(targetSvg);
     }
 }
 
-static void processCln(const char *params, List figures, FILE *mainSvg, const char *baseOutPath, char sortType, int sortThreshold, FILE *txtFile) {
+static void processCln(const char *params, List figures, FigureBounds bounds, SvgWriter mainSvg, const char *baseOutPath, char sortType, int sortThreshold, Report report) {
     double x, y, dx, dy;
     char sfx[64];
     
@@ -229,19 +320,20 @@ static void processCln(const char *params, List figures, FILE *mainSvg, const ch
 
     static int idCounter = 90000;
 
-    FILE *targetSvg = mainSvg;
+    SvgWriter targetSvg = mainSvg;
     bool isSeparateFile = (strcmp(sfx, "-") != 0);
-    char auxSvgPath[512];
 
     if (isSeparateFile) {
-        makeSvgPathWithSuffix(baseOutPath, sfx, auxSvgPath);
-        targetSvg = fopen(auxSvgPath, "w");
+        targetSvg = openSuffixSvg(baseOutPath, sfx, figures);
         if (!targetSvg) return;
-        svgInit(targetSvg);
-        svgDrawAll(targetSvg, figures);
     }
 
-    fprintf(targetSvg, "\t<text x=\"%lf\" y=\"%lf\" fill=\"blue\" font-weight=\"bold\">CLN</text>\n", x, y);
+    SvgWriter overlay = beginOverlay(targetSvg);
+    svgWritef(overlay, "\t<text x=\"%f\" y=\"%f\" fill=\"blue\" font-weight=\"bold\">CLN</text>\n", x, y);
+    // Texto alinhado à esquerda em x com a linha de base em y; largura
+    // estimada por excesso, uma fonte por letra (como figureGetExtent)
+    endOverlay(overlay, targetSvg, x, y - CLN_FONT_SIZE, x + 3 * CLN_FONT_SIZE,
+               y + CLN_FONT_SIZE / 4.0, false);
 
     List clones = listInit();
     int i = 0;
@@ -258,7 +350,7 @@ static void processCln(const char *params, List figures, FILE *mainSvg, const ch
         if (getFigureShape(f) == LINE) continue; 
 
         // Checar se o centro da figura está dentro do polígono de visibilidade
-        if (visIsVisible(figures, x, y, fx, fy)) {
+        if (visIsVisible(figures, bounds, x, y, fx, fy)) {
             int shape = getFigureShape(f);
             int originalId = getFigureId(f);
             
@@ -269,6 +361,7 @@ static void processCln(const char *params, List figures, FILE *mainSvg, const ch
             
             Figure nf = figureInit(shape);
             int newId = idCounter++;
+            TED_PROBE3(figure__clone, originalId, newId, shape);
 
             // Lógica de clonagem com deslocamento
             if (shape == CIRCLE) {
@@ -289,10 +382,13 @@ static void processCln(const char *params, List figures, FILE *mainSvg, const ch
             // Adiciona o clone à lista temporária
             listAddLast(clones, nf);
 
-            if (txtFile) {
+            if (report) {
                 // LOG CLN: id e tipo das figuras originais e dos clones
-                fprintf(txtFile, "CLN: Original[ID=%d, Tipo=%s] -> Clone[ID=%d] Deslocado(%.1f, %.1f)\n", 
-                        originalId, getShapeName(shape), newId, dx, dy);
+                ReportRecord rec;
+                reportRecordInit(&rec, REPORT_OP_CLN, originalId, shape);
+                rec.newId = newId;
+                rec.v[0] = dx; rec.v[1] = dy;
+                reportAdd(report, &rec);
             }
         }
     }
@@ -301,16 +397,17 @@ static void processCln(const char *params, List figures, FILE *mainSvg, const ch
     // Adiciona os clones à lista principal de figuras
     while ((data = listGetPos(clones, i++))) {
         listAddLast(figures, data);
+        figureBoundsAdd(bounds, data);
     }
     listFree(clones); 
 
     if (isSeparateFile) {
         svgClose(targetSvg);
-        fclose(targetSvg);
+        svgWriterClose(targetSvg);
     }
 }
 
-static void processQryLine(const char *line, FILE *mainSvg, const char *baseOutPath, FILE *txtFile, List figures, char sortType, int sortThreshold) {
+static void processQryLine(const char *line, int lineNumber, SvgWriter mainSvg, const char *baseOutPath, Report report, List figures, FigureBounds bounds, char sortType, int sortThreshold) {
     char command[32];
     char params[512];
     
@@ -319,36 +416,68 @@ static void processQryLine(const char *line, FILE *mainSvg, const char *baseOutP
 
     if (sscanf(line, "%s %[^\n]", command, params) < 1) return;
 
+    TED_PROBE2(command__start, command, lineNumber);
     if (strcmp(command, "a") == 0) 
-        processA(params, figures, txtFile);
+        processA(params, figures, bounds, report);
     else if (strcmp(command, "d") == 0) 
-        processD(params, figures, mainSvg, baseOutPath, sortType, sortThreshold, txtFile);
+        processD(params, figures, bounds, mainSvg, baseOutPath, sortType, sortThreshold, report);
     else if (strcmp(command, "p") == 0) 
-        processP(params, figures, mainSvg, baseOutPath, sortType, sortThreshold, txtFile);
+        processP(params, figures, bounds, mainSvg, baseOutPath, sortType, sortThreshold, report);
     else if (strcmp(command, "cln") == 0) 
-        processCln(params, figures, mainSvg, baseOutPath, sortType, sortThreshold, txtFile);
+        processCln(params, figures, bounds, mainSvg, baseOutPath, sortType, sortThreshold, report);
+    TED_PROBE2(command__done, command, lineNumber);
 }
 
-void processQry(const char *pathQry, const char *pathOut, List figures, char sortType, int sortThreshold, FILE *txtFile) {
+// Nome do comando para o trace (tem de ser uma string estática)
+static const char *commandLabel(const char *line) {
+    char command[16];
+    if (sscanf(line, "%15s", command) != 1) return "vazio";
+    if (strcmp(command, "a") == 0) return "a";
+    if (strcmp(command, "d") == 0) return "d";
+    if (strcmp(command, "p") == 0) return "p";
+    if (strcmp(command, "cln") == 0) return "cln";
+    return "desconhecido";
+}
+
+void processQry(const char *pathQry, const char *pathOut, List figures, FigureBounds bounds, char sortType, int sortThreshold, Report report) {
     FILE *fQry = fopen(pathQry, "r");
     if (!fQry) return;
 
-    FILE *fSvg = fopen(pathOut, "w");
+    SvgWriter fSvg = svgWriterOpen(pathOut);
     if (!fSvg) {
         fclose(fQry);
         return;
     }
 
+    statsCommandBegin();
     svgInit(fSvg);
     svgDrawAll(fSvg, figures);
+    statsPhaseEnd("desenho-qry");
 
     char line[512];
+    // Total de comandos para a estimativa do tempo restante
+    if (progressIsActive()) {
+        long total = 0;
+        while (fgets(line, sizeof(line), fQry)) total++;
+        progressSetTotal(total);
+        rewind(fQry);
+    }
+
+    int lineNumber = 0;
     while (fgets(line, sizeof(line), fQry)) {
         line[strcspn(line, "\r\n")] = 0;
-        processQryLine(line, fSvg, pathOut, txtFile, figures, sortType, sortThreshold);
+        reportSetCommand(report, ++lineNumber);
+        statsCommandBegin();
+        if (traceIsActive()) traceBeginArg(commandLabel(line), "qry", "linha", lineNumber);
+        processQryLine(line, lineNumber, fSvg, pathOut, report, figures, bounds, sortType, sortThreshold);
+        // Só os tiles afetados pelo comando são reescritos
+        tilesUpdate(figures);
+        traceEnd();
+        statsCommandEnd(lineNumber, line);
+        progressCommandDone(listGetSize(figures));
     }
 
     svgClose(fSvg);
-    fclose(fSvg);
+    svgWriterClose(fSvg);
     fclose(fQry);
 }
@@ -1,14 +1,29 @@
 #ifndef QRY_H
 #define QRY_H
 
+#include "figure.h"
 #include "list.h"
+#include "report.h"
+#include <stdbool.h>
 
 /**
  * @brief Processa o arquivo de consultas .qry.
  * @param pathQry Caminho completo para o ficheiro .qry de entrada.
  * @param pathOut Caminho (diretoria) onde o ficheiro .svg será salvo.
  * @param figures Lista contendo as figuras (obstáculos) já lidas do .geo.
+ * @param bounds Caixa envolvente da cena, alargada com as figuras criadas
+ * pelos comandos.
+ * @param report Relatório das operações, ou NULL para não o gerar.
  */
-void processQry(const char *pathQry, const char *pathOut, List figures, char sortType, int sortThreshold, FILE *txtFile);
+void processQry(const char *pathQry, const char *pathOut, List figures, FigureBounds bounds, char sortType, int sortThreshold, Report report);
+
+/**
+ * @brief Ativa o modo de referência dos arquivos de sufixo: em vez de copiar a
+ * cena inteira, cada arquivo referencia (<use href>) um SVG base partilhado,
+ * escrito uma única vez por versão da cena, e contém apenas o marcador e o
+ * polígono de visibilidade.
+ * @param enabled true para ativar.
+ */
+void qrySetReferenceSuffix(bool enabled);
 
 #endif
@@ -0,0 +1,271 @@
+#include "report.h"
+#include "figure.h"
+#include "svgwriter.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Registos acumulados antes de serem formatados e escritos
+#define REPORT_BATCH 1024
+// Espaço para um double em "%.17g" (o pior caso)
+#define REPORT_NUM_MAX 32
+
+// Definindo POLYGON como 5, um valor comum em figure.h para este tipo de projeto.
+#ifndef POLYGON
+#define POLYGON 5
+#endif
+
+typedef struct {
+  SvgWriter out;
+  int format;
+  int command;
+  int count;
+  ReportRecord records[REPORT_BATCH];
+} ReportStruct;
+
+const char *reportShapeName(int shape) {
+  switch (shape) {
+  case CIRCLE:
+    return "CIRCULO";
+  case RECTANGLE:
+    return "RETANGULO";
+  case LINE:
+    return "LINHA";
+  case TEXT:
+    return "TEXTO";
+  case POLYGON:
+    return "POLIGONO";
+  default:
+    return "DESCONHECIDO";
+  }
+}
+
+void reportFormatText(SvgWriter w, const ReportRecord *rec) {
+  const char *name = reportShapeName(rec->shape);
+  switch (rec->op) {
+  case REPORT_OP_A:
+    svgWritef(w,
+              "A: Figura Original ID %d (%s) -> Segmento Novo ID %d. "
+              "Extremos: (%.1f, %.1f) e (%.1f, %.1f). Cor: %s\n",
+              rec->id, name, rec->newId, rec->v[0], rec->v[1], rec->v[2],
+              rec->v[3], rec->color);
+    break;
+  case REPORT_OP_D:
+    svgWritef(w, "D: Figura destruída ID=%d Tipo=%s\n", rec->id, name);
+    break;
+  case REPORT_OP_P:
+    svgWritef(w, "P: Figura pintada ID=%d Tipo=%s Cor=%s\n", rec->id, name,
+              rec->color);
+    break;
+  case REPORT_OP_CLN:
+    svgWritef(w,
+              "CLN: Original[ID=%d, Tipo=%s] -> Clone[ID=%d] "
+              "Deslocado(%.1f, %.1f)\n",
+              rec->id, name, rec->newId, rec->v[0], rec->v[1]);
+    break;
+  default:
+    break;
+  }
+}
+
+// --- Escrita ---
+
+// Os valores vão com os algarismos necessários para serem lidos de volta sem
+// perda, para que a conversão para texto arredonde como o relatório original
+static void writeCsvNum(SvgWriter w, double v) {
+  char num[REPORT_NUM_MAX];
+  for (int digits = 15; digits <= 17; digits++) {
+    snprintf(num, sizeof(num), "%.*g", digits, v);
+    if (strtod(num, NULL) == v)
+      break;
+  }
+  svgWriteStr(w, num);
+}
+
+static void writeCsv(SvgWriter w, const ReportRecord *rec) {
+  svgWritef(w, "%d,%c,%d,%d,%d", rec->command, rec->op, rec->id, rec->shape,
+            rec->newId);
+  for (int i = 0; i < 4; i++) {
+    svgWriteBytes(w, ",", 1);
+    writeCsvNum(w, rec->v[i]);
+  }
+  // A cor vai entre aspas se tiver separadores
+  if (strpbrk(rec->color, ",\"\n")) {
+    svgWriteStr(w, ",\"");
+    for (const char *c = rec->color; *c; c++) {
+      if (*c == '"')
+        svgWriteBytes(w, "\"", 1);
+      svgWriteBytes(w, c, 1);
+    }
+    svgWriteStr(w, "\"\n");
+  } else {
+    svgWritef(w, ",%s\n", rec->color);
+  }
+}
+
+static void writeInt32(SvgWriter w, int v) {
+  int32_t x = (int32_t)v;
+  svgWriteBytes(w, (const char *)&x, sizeof(x));
+}
+
+static void writeBin(SvgWriter w, const ReportRecord *rec) {
+  svgWriteBytes(w, &rec->op, 1);
+  writeInt32(w, rec->command);
+  writeInt32(w, rec->id);
+  writeInt32(w, rec->shape);
+  writeInt32(w, rec->newId);
+  svgWriteBytes(w, (const char *)rec->v, sizeof(rec->v));
+  unsigned char len = (unsigned char)strlen(rec->color);
+  svgWriteBytes(w, (const char *)&len, 1);
+  svgWriteBytes(w, rec->color, len);
+}
+
+static void flushRecords(ReportStruct *r) {
+  for (int i = 0; i < r->count; i++) {
+    const ReportRecord *rec = &r->records[i];
+    if (r->format == REPORT_CSV)
+      writeCsv(r->out, rec);
+    else if (r->format == REPORT_BIN)
+      writeBin(r->out, rec);
+    else
+      reportFormatText(r->out, rec);
+  }
+  r->count = 0;
+}
+
+Report reportOpen(const char *path, int format) {
+  ReportStruct *r = malloc(sizeof(ReportStruct));
+  if (!r)
+    return NULL;
+  r->out = svgWriterOpen(path);
+  if (!r->out) {
+    free(r);
+    return NULL;
+  }
+  r->format = format;
+  r->command = 0;
+  r->count = 0;
+  if (format == REPORT_CSV)
+    svgWriteStr(r->out, REPORT_CSV_HEADER);
+  else if (format == REPORT_BIN)
+    svgWriteStr(r->out, REPORT_MAGIC);
+  return (Report)r;
+}
+
+void reportClose(Report rep) {
+  ReportStruct *r = (ReportStruct *)rep;
+  if (!r)
+    return;
+  flushRecords(r);
+  svgWriterClose(r->out);
+  free(r);
+}
+
+void reportSetCommand(Report rep, int command) {
+  ReportStruct *r = (ReportStruct *)rep;
+  if (r)
+    r->command = command;
+}
+
+void reportRecordInit(ReportRecord *rec, char op, int id, int shape) {
+  memset(rec, 0, sizeof(ReportRecord));
+  rec->op = op;
+  rec->id = id;
+  rec->shape = shape;
+  rec->newId = -1;
+}
+
+void reportAdd(Report rep, ReportRecord *rec) {
+  ReportStruct *r = (ReportStruct *)rep;
+  if (!r)
+    return;
+  rec->command = r->command;
+  r->records[r->count++] = *rec;
+  if (r->count == REPORT_BATCH)
+    flushRecords(r);
+}
+
+// --- Leitura ---
+
+int reportReadHeader(FILE *in) {
+  char header[64];
+  size_t magicLen = strlen(REPORT_MAGIC);
+  if (fread(header, 1, magicLen, in) == magicLen &&
+      memcmp(header, REPORT_MAGIC, magicLen) == 0)
+    return REPORT_BIN;
+
+  rewind(in);
+  if (fgets(header, sizeof(header), in) &&
+      strcmp(header, REPORT_CSV_HEADER) == 0)
+    return REPORT_CSV;
+  return -1;
+}
+
+static bool readInt32(FILE *in, int *v) {
+  int32_t x;
+  if (fread(&x, sizeof(x), 1, in) != 1)
+    return false;
+  *v = (int)x;
+  return true;
+}
+
+static bool readBin(FILE *in, ReportRecord *rec) {
+  unsigned char len;
+  if (fread(&rec->op, 1, 1, in) != 1 || !readInt32(in, &rec->command) ||
+      !readInt32(in, &rec->id) || !readInt32(in, &rec->shape) ||
+      !readInt32(in, &rec->newId) ||
+      fread(rec->v, sizeof(rec->v), 1, in) != 1 || fread(&len, 1, 1, in) != 1)
+    return false;
+  if (len >= sizeof(rec->color) || fread(rec->color, 1, len, in) != len)
+    return false;
+  rec->color[len] = '\0';
+  return true;
+}
+
+// Lê o campo da cor (último da linha), com ou sem aspas
+static bool parseCsvColor(const char *p, char *color, size_t size) {
+  size_t n = 0;
+  if (*p == '"') {
+    for (p++; *p; p++) {
+      if (*p == '"') {
+        if (p[1] != '"')
+          break;
+        p++;
+      }
+      if (n + 1 >= size)
+        return false;
+      color[n++] = *p;
+    }
+  } else {
+    for (; *p && *p != '\n' && *p != '\r'; p++) {
+      if (n + 1 >= size)
+        return false;
+      color[n++] = *p;
+    }
+  }
+  color[n] = '\0';
+  return true;
+}
+
+static bool readCsv(FILE *in, ReportRecord *rec) {
+  char line[512];
+  if (!fgets(line, sizeof(line), in))
+    return false;
+  int consumed = 0;
+  if (sscanf(line, "%d,%c,%d,%d,%d,%lf,%lf,%lf,%lf,%n", &rec->command,
+             &rec->op, &rec->id, &rec->shape, &rec->newId, &rec->v[0],
+             &rec->v[1], &rec->v[2], &rec->v[3], &consumed) != 9 ||
+      consumed == 0)
+    return false;
+  return parseCsvColor(line + consumed, rec->color, sizeof(rec->color));
+}
+
+bool reportRead(FILE *in, int format, ReportRecord *rec) {
+  memset(rec, 0, sizeof(ReportRecord));
+  if (format == REPORT_BIN)
+    return readBin(in, rec);
+  if (format == REPORT_CSV)
+    return readCsv(in, rec);
+  return false;
+}
@@ -0,0 +1,118 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "svgwriter.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief Tipo opaco para o relatório das consultas (o antigo log TXT).
+ * Os registos ficam num buffer e são escritos em lote, no formato escolhido.
+ */
+typedef void *Report;
+
+/**
+ * @brief Formatos do relatório: o texto original, CSV (um registo por linha,
+ * com cabeçalho) ou binário compacto (cabeçalho REPORT_MAGIC seguido dos
+ * registos, na ordem de bytes da máquina).
+ */
+#define REPORT_TEXT 0
+#define REPORT_CSV 1
+#define REPORT_BIN 2
+
+#define REPORT_MAGIC "TEDREP1\n"
+#define REPORT_CSV_HEADER "comando,op,id,forma,novo_id,v1,v2,v3,v4,cor\n"
+
+/**
+ * @brief Operações registadas.
+ */
+#define REPORT_OP_A 'a'
+#define REPORT_OP_D 'd'
+#define REPORT_OP_P 'p'
+#define REPORT_OP_CLN 'c'
+
+/**
+ * @brief Um registo do relatório.
+ * Em A, v guarda os extremos do segmento (x1, y1, x2, y2) e color a cor da
+ * borda; em P, color é a cor da pintura; em CLN, v[0] e v[1] são o
+ * deslocamento. Os campos sem uso ficam a zero (newId a -1).
+ */
+typedef struct {
+  int command; // linha do .qry que gerou o registo
+  char op;
+  int id;
+  int shape;
+  int newId;
+  double v[4];
+  char color[32];
+} ReportRecord;
+
+/**
+ * @brief Abre um relatório.
+ * @param path Caminho do ficheiro.
+ * @param format REPORT_TEXT, REPORT_CSV ou REPORT_BIN.
+ * @return O relatório, ou NULL se o ficheiro não puder ser aberto.
+ */
+Report reportOpen(const char *path, int format);
+
+/**
+ * @brief Escreve os registos pendentes, fecha o ficheiro e liberta o relatório.
+ * @param r O relatório.
+ */
+void reportClose(Report r);
+
+/**
+ * @brief Define a linha do .qry a que pertencem os registos seguintes.
+ * @param r O relatório.
+ * @param command Número da linha (a partir de 1).
+ */
+void reportSetCommand(Report r, int command);
+
+/**
+ * @brief Prepara um registo da operação op, com os campos opcionais vazios.
+ * @param rec O registo.
+ * @param op A operação (REPORT_OP_*).
+ * @param id Id da figura original.
+ * @param shape Forma da figura original.
+ */
+void reportRecordInit(ReportRecord *rec, char op, int id, int shape);
+
+/**
+ * @brief Acrescenta um registo; o campo command é preenchido pelo relatório.
+ * @param r O relatório (NULL é ignorado).
+ * @param rec O registo.
+ */
+void reportAdd(Report r, ReportRecord *rec);
+
+/**
+ * @brief Escreve um registo no formato de texto original.
+ * @param w O escritor.
+ * @param rec O registo.
+ */
+void reportFormatText(SvgWriter w, const ReportRecord *rec);
+
+/**
+ * @brief Nome de uma forma como aparece no texto do relatório.
+ * @param shape A forma.
+ * @return O nome (p.ex. "CIRCULO").
+ */
+const char *reportShapeName(int shape);
+
+/**
+ * @brief Identifica o formato de um relatório gravado e avança para o
+ * primeiro registo.
+ * @param in O ficheiro, no início.
+ * @return REPORT_CSV ou REPORT_BIN, ou -1 se não for reconhecido.
+ */
+int reportReadHeader(FILE *in);
+
+/**
+ * @brief Lê o próximo registo de um relatório CSV ou binário.
+ * @param in O ficheiro, depois de reportReadHeader.
+ * @param format O formato devolvido por reportReadHeader.
+ * @param rec Recebe o registo.
+ * @return true se um registo foi lido, false no fim ou em erro.
+ */
+bool reportRead(FILE *in, int format, ReportRecord *rec);
+
+#endif // REPORT_H
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+// Sem TED_STATS o cabeçalho reduz tudo a macros vazias
+#ifdef TED_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef TED_ALLOC_STATS
+#include <malloc.h> // malloc_usable_size (glibc)
+#endif
+
+#define STATS_MAX_TYPES 16
+
+// Um comando do .qry ou, com line == 0, uma fase
+typedef struct {
+  int line;
+  char command[16];
+  double ms;
+  unsigned long long delta[STAT_COUNT];
+  long long peakBytes;
+} CommandStats;
+
+// Agregado por tipo de comando (a, d, p, cln, ...)
+typedef struct {
+  char command[16];
+  int count;
+  double ms;
+  double maxMs;
+  unsigned long long delta[STAT_COUNT];
+  long long peakBytes;
+} TypeStats;
+
+static const char *g_statNames[STAT_COUNT] = {
+    "segmentos",  "eventos",     "cmp_arvore",   "cmp_eventos",
+    "rotacoes",   "intersecoes", "visIsVisible", "bytes",
+    "mallocs",    "frees",       "bytes_alocados"};
+
+atomic_ullong g_stats[STAT_COUNT];
+
+// Bytes vivos, o seu pico desde o início da fase atual e o pico da execução
+static atomic_llong g_liveBytes;
+static atomic_llong g_phasePeak;
+static atomic_llong g_runPeak;
+
+static FILE *g_file = NULL;
+static CommandStats *g_commands = NULL;
+static int g_commandCount = 0;
+static int g_commandCapacity = 0;
+static unsigned long long g_begin[STAT_COUNT];
+static double g_beginMs;
+static double g_openMs;
+
+static double nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+static void snapshot(unsigned long long *out) {
+  for (int c = 0; c < STAT_COUNT; c++)
+    out[c] = atomic_load_explicit(&g_stats[c], memory_order_relaxed);
+}
+
+// --- Alocações ---
+
+#ifdef TED_ALLOC_STATS
+
+static void raisePeak(atomic_llong *peak, long long live) {
+  long long seen = atomic_load_explicit(peak, memory_order_relaxed);
+  while (live > seen &&
+         !atomic_compare_exchange_weak_explicit(peak, &seen, live, memory_order_relaxed,
+                                                memory_order_relaxed))
+    ;
+}
+
+// Usa o tamanho real do bloco, para não precisar de cabeçalho próprio
+static void noteAlloc(void *p) {
+  long long n = (long long)malloc_usable_size(p);
+  STATS_ADD_SHARED(STAT_MALLOCS, 1);
+  STATS_ADD_SHARED(STAT_ALLOC_BYTES, n);
+  long long live = atomic_fetch_add_explicit(&g_liveBytes, n, memory_order_relaxed) + n;
+  raisePeak(&g_phasePeak, live);
+  raisePeak(&g_runPeak, live);
+}
+
+static void noteFree(size_t n) {
+  STATS_ADD_SHARED(STAT_FREES, 1);
+  atomic_fetch_sub_explicit(&g_liveBytes, (long long)n, memory_order_relaxed);
+}
+
+void *statsMalloc(size_t size) {
+  void *p = malloc(size);
+  if (p)
+    noteAlloc(p);
+  return p;
+}
+
+void *statsCalloc(size_t count, size_t size) {
+  void *p = calloc(count, size);
+  if (p)
+    noteAlloc(p);
+  return p;
+}
+
+void *statsRealloc(void *p, size_t size) {
+  size_t old = p ? malloc_usable_size(p) : 0;
+  void *q = realloc(p, size);
+  if (!q)
+    return NULL;
+  if (p)
+    noteFree(old);
+  noteAlloc(q);
+  return q;
+}
+
+void statsFree(void *p) {
+  if (!p)
+    return;
+  noteFree(malloc_usable_size(p));
+  free(p);
+}
+
+#endif // TED_ALLOC_STATS
+
+// --- Relatório ---
+
+bool statsOpen(const char *path) {
+  g_file = fopen(path, "w");
+  if (!g_file)
+    return false;
+  g_openMs = nowMs();
+  return true;
+}
+
+void statsCommandBegin(void) {
+  if (!g_file)
+    return;
+  snapshot(g_begin);
+  atomic_store_explicit(&g_phasePeak, atomic_load_explicit(&g_liveBytes, memory_order_relaxed),
+                        memory_order_relaxed);
+  g_beginMs = nowMs();
+}
+
+static void record(int lineNumber, const char *command, double ms) {
+  if (g_commandCount == g_commandCapacity) {
+    int capacity = g_commandCapacity ? 2 * g_commandCapacity : 256;
+    CommandStats *grown = realloc(g_commands, capacity * sizeof(CommandStats));
+    if (!grown)
+      return;
+    g_commands = grown;
+    g_commandCapacity = capacity;
+  }
+
+  CommandStats *cs = &g_commands[g_commandCount++];
+  cs->line = lineNumber;
+  snprintf(cs->command, sizeof(cs->command), "%s", command);
+  cs->ms = ms;
+  cs->peakBytes = atomic_load_explicit(&g_phasePeak, memory_order_relaxed);
+  unsigned long long now[STAT_COUNT];
+  snapshot(now);
+  for (int c = 0; c < STAT_COUNT; c++)
+    cs->delta[c] = now[c] - g_begin[c];
+}
+
+void statsPhaseEnd(const char *name) {
+  if (!g_file)
+    return;
+  record(0, name, nowMs() - g_beginMs);
+}
+
+void statsCommandEnd(int lineNumber, const char *line) {
+  if (!g_file)
+    return;
+  double ms = nowMs() - g_beginMs;
+  char command[16];
+  if (sscanf(line, "%15s", command) != 1)
+    return;
+  record(lineNumber, command, ms);
+}
+
+static void writeCounters(const unsigned long long *values, long long peakBytes) {
+  for (int c = 0; c < STAT_COUNT; c++)
+    fprintf(g_file, ",%llu", values[c]);
+  fprintf(g_file, ",%lld\n", peakBytes);
+}
+
+static void writeHeader(const char *prefix) {
+  fputs(prefix, g_file);
+  for (int c = 0; c < STAT_COUNT; c++)
+    fprintf(g_file, ",%s", g_statNames[c]);
+  fputs(",pico_bytes_vivos\n", g_file);
+}
+
+void statsClose(void) {
+  if (!g_file)
+    return;
+
+  fprintf(g_file, "# por fase\n");
+  writeHeader("fase,ms");
+  for (int i = 0; i < g_commandCount; i++) {
+    CommandStats *cs = &g_commands[i];
+    if (cs->line > 0)
+      continue;
+    fprintf(g_file, "%s,%.3f", cs->command, cs->ms);
+    writeCounters(cs->delta, cs->peakBytes);
+  }
+
+  fprintf(g_file, "\n# por comando\n");
+  writeHeader("linha,comando,ms");
+  int commands = 0;
+  for (int i = 0; i < g_commandCount; i++) {
+    CommandStats *cs = &g_commands[i];
+    if (cs->line == 0)
+      continue;
+    fprintf(g_file, "%d,%s,%.3f", cs->line, cs->command, cs->ms);
+    writeCounters(cs->delta, cs->peakBytes);
+    commands++;
+  }
+
+  TypeStats types[STATS_MAX_TYPES];
+  int typeCount = 0;
+  for (int i = 0; i < g_commandCount; i++) {
+    CommandStats *cs = &g_commands[i];
+    if (cs->line == 0)
+      continue;
+    int t = 0;
+    while (t < typeCount && strcmp(types[t].command, cs->command) != 0)
+      t++;
+    if (t == typeCount) {
+      if (typeCount == STATS_MAX_TYPES)
+        continue;
+      memset(&types[t], 0, sizeof(TypeStats));
+      strcpy(types[t].command, cs->command);
+      typeCount++;
+    }
+    types[t].count++;
+    types[t].ms += cs->ms;
+    if (cs->ms > types[t].maxMs)
+      types[t].maxMs = cs->ms;
+    if (cs->peakBytes > types[t].peakBytes)
+      types[t].peakBytes = cs->peakBytes;
+    for (int c = 0; c < STAT_COUNT; c++)
+      types[t].delta[c] += cs->delta[c];
+  }
+
+  fprintf(g_file, "\n# por tipo de comando\n");
+  writeHeader("comando,n,ms_total,ms_max");
+  for (int t = 0; t < typeCount; t++) {
+    fprintf(g_file, "%s,%d,%.3f,%.3f", types[t].command, types[t].count,
+            types[t].ms, types[t].maxMs);
+    writeCounters(types[t].delta, types[t].peakBytes);
+  }
+
+  // Inclui o que ficou fora das fases e dos comandos
+  fprintf(g_file, "\n# total da execução\n");
+  writeHeader("comandos,ms");
+  unsigned long long total[STAT_COUNT];
+  snapshot(total);
+  fprintf(g_file, "%d,%.3f", commands, nowMs() - g_openMs);
+  writeCounters(total, atomic_load_explicit(&g_runPeak, memory_order_relaxed));
+
+  fclose(g_file);
+  g_file = NULL;
+  free(g_commands);
+  g_commands = NULL;
+  g_commandCount = g_commandCapacity = 0;
+}
+
+#endif // TED_STATS
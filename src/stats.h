@@ -0,0 +1,121 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * @brief Contadores de desempenho, somados ao longo de toda a execução e
+ * repartidos por fase (leitura, desenho) e por comando do .qry no relatório
+ * de -stats.
+ */
+typedef enum {
+  STAT_SEGMENTS,      // segmentos criados para a varredura
+  STAT_EVENTS,        // eventos ordenados
+  STAT_TREE_CMP,      // chamadas ao comparador da árvore
+  STAT_EVENT_CMP,     // chamadas ao comparador de eventos
+  STAT_ROTATIONS,     // rotações da árvore AVL
+  STAT_INTERSECTIONS, // testes raio-segmento/arco
+  STAT_VISIBLE_CALLS, // chamadas a visIsVisible
+  STAT_BYTES,         // bytes descarregados para escrita (antes da compressão)
+  STAT_MALLOCS,       // alocações (TED_MALLOC/CALLOC/REALLOC)
+  STAT_FREES,         // libertações (TED_FREE e o bloco antigo de TED_REALLOC)
+  STAT_ALLOC_BYTES,   // bytes alocados
+  STAT_COUNT
+} StatCounter;
+
+#ifdef TED_STATS
+
+#include <stdatomic.h>
+
+#define STATS_ENABLED 1
+
+extern atomic_ullong g_stats[STAT_COUNT];
+
+/**
+ * @brief Soma n a um contador só atualizado pela thread de cálculo (carga e
+ * escrita relaxadas, sem instrução atómica de leitura-escrita).
+ */
+#define STATS_ADD(c, n)                                                        \
+  atomic_store_explicit(                                                       \
+      &g_stats[c],                                                             \
+      atomic_load_explicit(&g_stats[c], memory_order_relaxed) + (n),           \
+      memory_order_relaxed)
+
+/**
+ * @brief Soma n a um contador atualizado por várias threads.
+ */
+#define STATS_ADD_SHARED(c, n)                                                 \
+  atomic_fetch_add_explicit(&g_stats[c], (n), memory_order_relaxed)
+
+/**
+ * @brief Ativa o relatório de estatísticas, escrito em path por statsClose.
+ * @return false se o ficheiro não puder ser criado.
+ */
+bool statsOpen(const char *path);
+
+/**
+ * @brief Marca o início de um comando do .qry (contadores e relógio).
+ */
+void statsCommandBegin(void);
+
+/**
+ * @brief Marca o fim de uma fase fora do .qry (leitura, desenho), iniciada
+ * também por statsCommandBegin.
+ * @param name Nome da fase.
+ */
+void statsPhaseEnd(const char *name);
+
+/**
+ * @brief Marca o fim do comando iniciado por statsCommandBegin.
+ * @param lineNumber Linha do comando no .qry.
+ * @param line Texto do comando; a primeira palavra dá o tipo.
+ */
+void statsCommandEnd(int lineNumber, const char *line);
+
+/**
+ * @brief Escreve o relatório (por comando, por tipo e total) e desativa as
+ * estatísticas. Sem efeito se statsOpen não foi chamada.
+ */
+void statsClose(void);
+
+#else
+
+// Compilado sem TED_STATS (make STATS=0): nada disto gera código
+#define STATS_ENABLED 0
+#define STATS_ADD(c, n) ((void)0)
+#define STATS_ADD_SHARED(c, n) ((void)0)
+#define statsOpen(path) false
+#define statsCommandBegin() ((void)0)
+#define statsPhaseEnd(name) ((void)0)
+#define statsCommandEnd(lineNumber, line) ((void)0)
+#define statsClose() ((void)0)
+
+#endif // TED_STATS
+
+#define STATS_INC(c) STATS_ADD(c, 1)
+
+/**
+ * @brief Alocação contabilizada, usada em figure.c, list.c, tree.c e vis.c:
+ * conta chamadas, bytes, bytes vivos e o pico de bytes vivos por fase. Com
+ * make ALLOCS=0 (ou STATS=0) são o malloc/free normais. Um bloco obtido com
+ * TED_MALLOC deve ser libertado com TED_FREE, senão continua a contar como
+ * vivo.
+ */
+#ifdef TED_ALLOC_STATS
+void *statsMalloc(size_t size);
+void *statsCalloc(size_t count, size_t size);
+void *statsRealloc(void *p, size_t size);
+void statsFree(void *p);
+#define TED_MALLOC(size) statsMalloc(size)
+#define TED_CALLOC(count, size) statsCalloc(count, size)
+#define TED_REALLOC(p, size) statsRealloc(p, size)
+#define TED_FREE(p) statsFree(p)
+#else
+#define TED_MALLOC(size) malloc(size)
+#define TED_CALLOC(count, size) calloc(count, size)
+#define TED_REALLOC(p, size) realloc(p, size)
+#define TED_FREE(p) free(p)
+#endif
+
+#endif // STATS_H
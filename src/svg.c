@@ -1,47 +1,61 @@
 #include "svg.h"
 #include "figure.h"
 #include "list.h"
+#include "stats.h"
+#include "trace.h"
 
-#include <stdio.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
-static void svgDrawCircle(FILE *svgFile, Figure f) {
+// Abaixo disto a divisão em faixas não compensa
+#define SVG_PARALLEL_MIN 8192
+// Figuras por faixa
+#define SVG_RANGE_SIZE 2048
+// Faixas prontas que podem esperar pela escrita (limita a memória usada)
+#define SVG_RANGE_WINDOW 4
+#define SVG_MAX_THREADS 64
+
+static int g_threads = 1;
+
+static void svgDrawCircle(SvgWriter svg, Figure f) {
   char colorB[32], colorF[32];
   double x, y;
   getFigureColors(f, colorB, colorF);
   getFigureXY(&x, &y, f);
-  fprintf(svgFile,
-          "\t<circle cx=\"%lf\" cy=\"%lf\" r=\"%lf\" stroke=\"%s\" fill=\"%s\" "
-          "/>\n",
-          x, y, getCircleR(f), colorB, colorF);
+  svgWritef(svg,
+            "\t<circle cx=\"%f\" cy=\"%f\" r=\"%f\" stroke=\"%s\" fill=\"%s\" "
+            "/>\n",
+            x, y, getCircleR(f), colorB, colorF);
 }
 
-static void svgDrawRectangle(FILE *svgFile, Figure f) {
+static void svgDrawRectangle(SvgWriter svg, Figure f) {
   char colorB[32], colorF[32];
   double x, y, w, h;
   getFigureColors(f, colorB, colorF);
   getFigureXY(&x, &y, f);
   getRectangleWH(f, &w, &h);
 
-  fprintf(svgFile,
-          "\t<rect x=\"%lf\" y=\"%lf\" width=\"%lf\" height=\"%lf\" "
-          "stroke=\"%s\" fill=\"%s\" />\n",
-          x, y, w, h, colorB, colorF);
+  svgWritef(svg,
+            "\t<rect x=\"%f\" y=\"%f\" width=\"%f\" height=\"%f\" "
+            "stroke=\"%s\" fill=\"%s\" />\n",
+            x, y, w, h, colorB, colorF);
 }
 
-static void svgDrawLine(FILE *svgFile, Figure f) {
+static void svgDrawLine(SvgWriter svg, Figure f) {
   char colorB[32], colorF_dummy[32];
   double x1, y1, x2, y2;
   getFigureColors(f, colorB, colorF_dummy);
   getLineP(f, &x1, &y1, &x2, &y2);
 
-  fprintf(svgFile,
-          "\t<line x1=\"%lf\" y1=\"%lf\" x2=\"%lf\" y2=\"%lf\" "
-          "stroke=\"%s\" />\n",
-          x1, y1, x2, y2, colorB);
+  svgWritef(svg,
+            "\t<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" "
+            "stroke=\"%s\" />\n",
+            x1, y1, x2, y2, colorB);
 }
 
-static void svgDrawText(FILE *svgFile, Figure f) {
+static void svgDrawText(SvgWriter svg, Figure f) {
   char colorB[32], colorF[32];
   char txt[256], family[64], weight[3];
   char anchor;
@@ -76,58 +90,215 @@ static void svgDrawText(FILE *svgFile, Figure f) {
   else
     strcpy(svgWeight, "normal");
 
-  fprintf(
-      svgFile,
-      "\t<text x=\"%lf\" y=\"%lf\" fill=\"%s\" stroke=\"%s\" "
+  svgWritef(
+      svg,
+      "\t<text x=\"%f\" y=\"%f\" fill=\"%s\" stroke=\"%s\" "
       "text-anchor=\"%s\" "
       "font-family=\"%s\" font-size=\"%d\" font-weight=\"%s\"> %s</text>\n ",
       x, y, colorF, colorB, anchorStr, family, size, svgWeight, txt);
 }
 
-void svgInit(FILE *svgFile) {
-  if (!svgFile)
+void svgInit(SvgWriter svg) {
+  if (!svg)
     return;
-  fprintf(svgFile,
-          "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n");
+  svgWriteStr(svg,
+              "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n");
 }
 
-void svgClose(FILE *svgFile) {
-  if (!svgFile)
+void svgClose(SvgWriter svg) {
+  if (!svg)
     return;
-  fprintf(svgFile, "</svg>\n");
+  svgWriteStr(svg, "</svg>\n");
 }
 
-void svgDrawFigure(FILE *svgFile, Figure f) {
-  if (!svgFile || !f)
-    return;
+static void svgSerializeFigure(SvgWriter svg, Figure f) {
   int shape = getFigureShape(f);
   switch (shape) {
   case CIRCLE:
-    svgDrawCircle(svgFile, f);
+    svgDrawCircle(svg, f);
     break;
   case RECTANGLE:
-    svgDrawRectangle(svgFile, f);
+    svgDrawRectangle(svg, f);
     break;
   case LINE:
-    svgDrawLine(svgFile, f);
+    svgDrawLine(svg, f);
     break;
   case TEXT:
-    svgDrawText(svgFile, f);
+    svgDrawText(svg, f);
     break;
   default:
     break;
   }
 }
 
-void svgDrawAll(FILE *svgFile, List figureList) {
-  if (!svgFile || !figureList)
+void svgDrawFigure(SvgWriter svg, Figure f) {
+  if (!svg || !f)
+    return;
+
+  // Reaproveita o elemento já serializado enquanto a figura não mudar
+  int precision = svgWriterGetPrecision(svg);
+  size_t len;
+  const char *cached = figureGetCache(f, precision, &len);
+  if (cached) {
+    svgWriteBytes(svg, cached, len);
+    return;
+  }
+
+  SvgWriter element = svgWriterInitMemory();
+  if (!element) {
+    svgSerializeFigure(svg, f);
+    return;
+  }
+  svgWriterSetPrecision(element, precision);
+  svgSerializeFigure(element, f);
+  const char *data = svgWriterData(element, &len);
+  figureSetCache(f, data, len, precision);
+  svgWriteBytes(svg, data, len);
+  svgWriterClose(element);
+}
+
+void svgSetThreads(int threads) {
+  if (threads < 1)
+    threads = 1;
+  if (threads > SVG_MAX_THREADS)
+    threads = SVG_MAX_THREADS;
+  g_threads = threads;
+}
+
+// Trabalho partilhado entre as threads de serialização. Cada faixa é de uma
+// só thread, por isso as caches das figuras nunca são tocadas em simultâneo.
+typedef struct {
+  Figure *figures;
+  int count;
+  int precision;
+  int ranges;
+  SvgWriter *out;
+  bool *done;
+  int next;    // próxima faixa por serializar
+  int written; // faixas já escritas pela thread principal
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} DrawJob;
+
+static void *drawRangeWorker(void *arg) {
+  DrawJob *job = (DrawJob *)arg;
+  pthread_mutex_lock(&job->lock);
+  while (job->next < job->ranges) {
+    // Não se adianta demasiado em relação à escrita
+    if (job->next >= job->written + g_threads * SVG_RANGE_WINDOW) {
+      pthread_cond_wait(&job->cond, &job->lock);
+      continue;
+    }
+    int r = job->next++;
+    pthread_mutex_unlock(&job->lock);
+
+    traceBeginArg("faixa", "svg", "faixa", r);
+    SvgWriter out = svgWriterInitMemory();
+    if (out) {
+      svgWriterSetPrecision(out, job->precision);
+      int end = (r + 1) * SVG_RANGE_SIZE;
+      if (end > job->count)
+        end = job->count;
+      for (int i = r * SVG_RANGE_SIZE; i < end; i++)
+        svgDrawFigure(out, job->figures[i]);
+    }
+    traceEnd();
+
+    pthread_mutex_lock(&job->lock);
+    job->out[r] = out;
+    job->done[r] = true;
+    pthread_cond_broadcast(&job->cond);
+  }
+  pthread_mutex_unlock(&job->lock);
+  return NULL;
+}
+
+// Serializa as faixas em paralelo e escreve-as por ordem. Devolve false se
+// não conseguir preparar o trabalho (o chamador faz então a versão sequencial).
+static bool drawAllParallel(SvgWriter svg, Figure *figures, int count) {
+  DrawJob job;
+  job.figures = figures;
+  job.count = count;
+  job.precision = svgWriterGetPrecision(svg);
+  job.ranges = (count + SVG_RANGE_SIZE - 1) / SVG_RANGE_SIZE;
+  job.out = calloc((size_t)job.ranges, sizeof(SvgWriter));
+  job.done = calloc((size_t)job.ranges, sizeof(bool));
+  job.next = 0;
+  job.written = 0;
+  if (!job.out || !job.done) {
+    free(job.out);
+    free(job.done);
+    return false;
+  }
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.cond, NULL);
+
+  pthread_t threads[SVG_MAX_THREADS];
+  int started = 0;
+  while (started < g_threads &&
+         pthread_create(&threads[started], NULL, drawRangeWorker, &job) == 0)
+    started++;
+
+  for (int r = 0; r < job.ranges; r++) {
+    pthread_mutex_lock(&job.lock);
+    while (!job.done[r] && started > 0)
+      pthread_cond_wait(&job.cond, &job.lock);
+    SvgWriter out = job.out[r];
+    pthread_mutex_unlock(&job.lock);
+
+    int end = (r + 1) * SVG_RANGE_SIZE;
+    if (end > count)
+      end = count;
+    if (out) {
+      size_t len;
+      const char *data = svgWriterData(out, &len);
+      svgWriteBytes(svg, data, len);
+      svgWriterClose(out);
+    } else {
+      // Sem threads ou sem memória para a faixa: serializa aqui mesmo
+      for (int i = r * SVG_RANGE_SIZE; i < end; i++)
+        svgDrawFigure(svg, figures[i]);
+    }
+
+    pthread_mutex_lock(&job.lock);
+    job.written++;
+    pthread_cond_broadcast(&job.cond);
+    pthread_mutex_unlock(&job.lock);
+  }
+
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&job.lock);
+  pthread_cond_destroy(&job.cond);
+  free(job.out);
+  free(job.done);
+  return true;
+}
+
+void svgDrawAll(SvgWriter svg, List figureList) {
+  if (!svg || !figureList)
+    return;
+
+  // Um vetor evita o listGetPos por posição, que torna o percurso quadrático
+  int count;
+  Figure *figures = (Figure *)listToArray(figureList, &count);
+  if (figures) {
+    traceBeginArg("svgDrawAll", "svg", "figuras", count);
+    if (g_threads < 2 || count < SVG_PARALLEL_MIN ||
+        !drawAllParallel(svg, figures, count)) {
+      for (int i = 0; i < count; i++)
+        svgDrawFigure(svg, figures[i]);
+    }
+    traceEnd();
+    TED_FREE(figures);
     return;
+  }
 
   int i = 0;
   void *data;
   while ((data = listGetPos(figureList, i)) != NULL) {
     Figure f = (Figure)data;
-    svgDrawFigure(svgFile, f);
+    svgDrawFigure(svg, f);
     i++;
   }
 }
@@ -3,32 +3,41 @@
 
 #include "figure.h"
 #include "list.h"
-#include <stdio.h>
+#include "svgwriter.h"
 
 /**
  * @brief Escreve o cabeçalho SVG em um arquivo.
- * @param svgFile Ponteiro para o arquivo SVG (aberto para escrita).
+ * @param svg O escritor do arquivo SVG.
  */
-void svgInit(FILE *svgFile);
+void svgInit(SvgWriter svg);
 
 /**
  * @brief Escreve o rodapé SVG (tag </svg>) em um arquivo.
- * @param svgFile Ponteiro para o arquivo SVG.
+ * @param svg O escritor do arquivo SVG.
  */
-void svgClose(FILE *svgFile);
+void svgClose(SvgWriter svg);
 
 /**
  * @brief Desenha uma única figura no arquivo SVG.
- * @param svgFile Ponteiro para o arquivo SVG.
+ * @param svg O escritor do arquivo SVG.
  * @param f A figura (Figure) a ser desenhada.
  */
-void svgDrawFigure(FILE *svgFile, Figure f);
+void svgDrawFigure(SvgWriter svg, Figure f);
 
 /**
  * @brief Itera sobre uma Queue de Figure.
- * @param svgFile Ponteiro para o arquivo SVG.
+ * Com mais de uma thread (svgSetThreads) e listas grandes, a lista é dividida
+ * em faixas serializadas em paralelo, cada uma para o seu buffer, e os buffers
+ * são escritos por ordem. O resultado é idêntico ao da versão sequencial.
+ * @param svg O escritor do arquivo SVG.
  * @param figureList A List contendo as Figure.
  */
-void svgDrawAll(FILE *svgFile, List figureList);
+void svgDrawAll(SvgWriter svg, List figureList);
+
+/**
+ * @brief Define quantas threads svgDrawAll usa para serializar as figuras.
+ * @param threads Número de threads (1 = sequencial, o valor por omissão).
+ */
+void svgSetThreads(int threads);
 
 #endif // SVG_H
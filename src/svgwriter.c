@@ -0,0 +1,433 @@
+#include "svgwriter.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "trace.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define SVG_BUFFER_SIZE PIPELINE_BUFFER_SIZE
+#define SVG_MEMORY_INITIAL 256
+// Espaço suficiente para qualquer número formatado
+#define SVG_NUM_MAX 64
+
+// Com file, gz e channel a NULL o escritor é em memória e o buffer cresce
+// conforme preciso. Com channel, os buffers cheios vão para a thread de escrita.
+typedef struct {
+  FILE *file;
+  gzFile gz;
+  PipeChannel channel;
+  bool ownsFile;
+  int precision;
+  size_t used;
+  size_t capacity;
+  char *buffer;
+} SvgWriterStruct;
+
+static int g_defaultPrecision = SVG_DEFAULT_PRECISION;
+static int g_compression = 0;
+
+static const unsigned long long POW10[] = {
+    1ULL,      10ULL,      100ULL,      1000ULL,      10000ULL,
+    100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL};
+
+static int clampPrecision(int digits) {
+  if (digits < 0)
+    return 0;
+  if (digits > 9)
+    return 9;
+  return digits;
+}
+
+static bool isMemory(SvgWriterStruct *w) {
+  return !w->file && !w->gz && !w->channel;
+}
+
+static SvgWriterStruct *newWriter(FILE *file, size_t capacity) {
+  SvgWriterStruct *w = malloc(sizeof(SvgWriterStruct));
+  if (!w)
+    return NULL;
+  w->buffer = malloc(capacity);
+  if (!w->buffer) {
+    free(w);
+    return NULL;
+  }
+  w->file = file;
+  w->gz = NULL;
+  w->channel = NULL;
+  w->ownsFile = false;
+  w->precision = g_defaultPrecision;
+  w->used = 0;
+  w->capacity = capacity;
+  return w;
+}
+
+// Escritor cujos buffers são escritos pela thread de escrita, que passa a
+// ser dona de file/gz
+static SvgWriterStruct *newAsyncWriter(FILE *file, gzFile gz, bool ownsFile) {
+  SvgWriterStruct *w = malloc(sizeof(SvgWriterStruct));
+  if (!w)
+    return NULL;
+  w->buffer = pipelineAcquireBuffer();
+  if (!w->buffer) {
+    free(w);
+    return NULL;
+  }
+  w->channel = pipelineOpen(file, gz, ownsFile);
+  if (!w->channel) {
+    pipelineReleaseBuffer(w->buffer);
+    free(w);
+    return NULL;
+  }
+  w->file = NULL;
+  w->gz = NULL;
+  w->ownsFile = false;
+  w->precision = g_defaultPrecision;
+  w->used = 0;
+  w->capacity = SVG_BUFFER_SIZE;
+  return w;
+}
+
+SvgWriter svgWriterInit(FILE *file) {
+  if (!file)
+    return NULL;
+  if (pipelineIsActive())
+    return (SvgWriter)newAsyncWriter(file, NULL, false);
+  return (SvgWriter)newWriter(file, SVG_BUFFER_SIZE);
+}
+
+SvgWriter svgWriterInitMemory(void) {
+  return (SvgWriter)newWriter(NULL, SVG_MEMORY_INITIAL);
+}
+
+const char *svgWriterData(SvgWriter sw, size_t *len) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w || !isMemory(w)) {
+    *len = 0;
+    return NULL;
+  }
+  *len = w->used;
+  return w->buffer;
+}
+
+void svgWriterReset(SvgWriter sw) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w || !isMemory(w))
+    return;
+  w->used = 0;
+}
+
+void svgWriterSetCompression(int level) {
+  if (level < 0)
+    level = 0;
+  if (level > 9)
+    level = 9;
+  g_compression = level;
+}
+
+int svgWriterGetCompression(void) { return g_compression; }
+
+void svgWriterOutputPath(const char *path, char *dest, size_t size) {
+  size_t len = strlen(path);
+  const char *suffix = "";
+  if (g_compression > 0)
+    suffix = (len >= 4 && strcmp(path + len - 4, ".svg") == 0) ? "z" : ".gz";
+  snprintf(dest, size, "%s%s", path, suffix);
+}
+
+SvgWriter svgWriterOpen(const char *path) {
+  // O ficheiro é sempre aberto aqui, para que uma falha chegue a quem chama;
+  // em modo assíncrono a escrita (e a compressão) passa depois para a thread
+  // de escrita
+  FILE *file = NULL;
+  gzFile gz = NULL;
+  if (g_compression > 0) {
+    char actual[1024], mode[16];
+    svgWriterOutputPath(path, actual, sizeof(actual));
+    snprintf(mode, sizeof(mode), "wb%d", g_compression);
+    gz = gzopen(actual, mode);
+    if (!gz)
+      return NULL;
+  } else {
+    file = fopen(path, "w");
+    if (!file)
+      return NULL;
+  }
+
+  SvgWriterStruct *w;
+  if (pipelineIsActive()) {
+    w = newAsyncWriter(file, gz, true);
+  } else {
+    w = newWriter(file, SVG_BUFFER_SIZE);
+    if (w) {
+      w->gz = gz;
+      w->ownsFile = true;
+    }
+  }
+  if (!w) {
+    if (gz)
+      gzclose(gz);
+    else
+      fclose(file);
+    return NULL;
+  }
+  return (SvgWriter)w;
+}
+
+void svgWriterFlush(SvgWriter sw) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w || isMemory(w) || w->used == 0)
+    return;
+  traceBeginArg("flush", "svg", "bytes", (long)w->used);
+  if (w->channel) {
+    char *next = pipelineAcquireBuffer();
+    pipelineSubmit(w->channel, w->buffer, w->used);
+    if (!next) {
+      // Sem memória para um buffer novo: espera que a thread de escrita
+      // devolva um (há pelo menos o que acabou de ser entregue)
+      static atomic_flag warned = ATOMIC_FLAG_INIT;
+      if (!atomic_flag_test_and_set(&warned))
+        fprintf(stderr, "AVISO: Sem memória para buffers de escrita; à espera da thread de escrita\n");
+      next = pipelineAwaitBuffer();
+    }
+    w->buffer = next;
+  } else if (w->gz) {
+    gzwrite(w->gz, w->buffer, (unsigned)w->used);
+  } else {
+    fwrite(w->buffer, 1, w->used, w->file);
+  }
+  STATS_ADD_SHARED(STAT_BYTES, w->used);
+  w->used = 0;
+  traceEnd();
+}
+
+void svgWriterClose(SvgWriter sw) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w)
+    return;
+  svgWriterFlush(w);
+  if (w->channel) {
+    pipelineClose(w->channel);
+    pipelineReleaseBuffer(w->buffer);
+    free(w);
+    return;
+  }
+  if (w->gz)
+    gzclose(w->gz);
+  else if (w->ownsFile)
+    fclose(w->file);
+  else if (w->file)
+    fflush(w->file);
+  free(w->buffer);
+  free(w);
+}
+
+void svgWriterSetDefaultPrecision(int digits) {
+  g_defaultPrecision = clampPrecision(digits);
+}
+
+void svgWriterSetPrecision(SvgWriter sw, int digits) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w)
+    return;
+  w->precision = clampPrecision(digits);
+}
+
+int svgWriterGetPrecision(SvgWriter sw) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w)
+    return g_defaultPrecision;
+  return w->precision;
+}
+
+static bool growMemory(SvgWriterStruct *w, size_t needed) {
+  size_t capacity = w->capacity;
+  while (capacity < needed)
+    capacity *= 2;
+  char *buffer = realloc(w->buffer, capacity);
+  if (!buffer)
+    return false;
+  w->buffer = buffer;
+  w->capacity = capacity;
+  return true;
+}
+
+void svgWriteBytes(SvgWriter sw, const char *data, size_t len) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w)
+    return;
+  if (w->used + len > w->capacity) {
+    if (isMemory(w)) {
+      if (!growMemory(w, w->used + len))
+        return;
+    } else {
+      svgWriterFlush(w);
+      // Blocos maiores que o buffer vão diretos para o ficheiro ou, com
+      // compressão ou em modo assíncrono, seguem em pedaços do tamanho do
+      // buffer
+      if (len > w->capacity && w->file) {
+        fwrite(data, 1, len, w->file);
+        STATS_ADD_SHARED(STAT_BYTES, len);
+        return;
+      }
+      while (len > w->capacity) {
+        memcpy(w->buffer, data, w->capacity);
+        w->used = w->capacity;
+        svgWriterFlush(w);
+        data += w->capacity;
+        len -= w->capacity;
+      }
+    }
+  }
+  memcpy(w->buffer + w->used, data, len);
+  w->used += len;
+}
+
+void svgWriteStr(SvgWriter w, const char *s) {
+  svgWriteBytes(w, s, strlen(s));
+}
+
+static char *formatUnsigned(char *p, unsigned long long v) {
+  char tmp[24];
+  int n = 0;
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (n > 0)
+    *p++ = tmp[--n];
+  return p;
+}
+
+// Formata v com 'precision' casas, arredondando e removendo zeros finais.
+// Valores fora do alcance de um inteiro de 64 bits usam snprintf.
+static size_t formatNum(char *out, double v, int precision) {
+  double scaled = v * (double)POW10[precision];
+  if (!isfinite(scaled) || fabs(scaled) >= 9.0e18) {
+    int len = snprintf(out, SVG_NUM_MAX, "%.*f", precision, v);
+    if (len < 0 || len >= SVG_NUM_MAX)
+      len = snprintf(out, SVG_NUM_MAX, "%g", v);
+    if (strchr(out, '.') && strchr(out, 'e') == NULL) {
+      while (out[len - 1] == '0')
+        len--;
+      if (out[len - 1] == '.')
+        len--;
+    }
+    return (size_t)len;
+  }
+
+  long long n = llround(scaled);
+  char *p = out;
+  if (n == 0) {
+    *p++ = '0';
+    return 1;
+  }
+  unsigned long long mag;
+  if (n < 0) {
+    *p++ = '-';
+    mag = (unsigned long long)(-n);
+  } else {
+    mag = (unsigned long long)n;
+  }
+
+  unsigned long long ip = mag / POW10[precision];
+  unsigned long long frac = mag % POW10[precision];
+  p = formatUnsigned(p, ip);
+  if (frac != 0) {
+    int digits = precision;
+    while (frac % 10 == 0) {
+      frac /= 10;
+      digits--;
+    }
+    *p++ = '.';
+    char *end = p + digits;
+    for (char *q = end - 1; q >= p; q--) {
+      *q = (char)('0' + frac % 10);
+      frac /= 10;
+    }
+    p = end;
+  }
+  return (size_t)(p - out);
+}
+
+void svgWriteNum(SvgWriter sw, double v) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w)
+    return;
+  char num[SVG_NUM_MAX];
+  size_t len = formatNum(num, v, w->precision);
+  svgWriteBytes(w, num, len);
+}
+
+void svgWritef(SvgWriter sw, const char *fmt, ...) {
+  SvgWriterStruct *w = (SvgWriterStruct *)sw;
+  if (!w || !fmt)
+    return;
+
+  va_list args;
+  va_start(args, fmt);
+  const char *run = fmt;
+  const char *p = fmt;
+  while (*p) {
+    if (*p != '%') {
+      p++;
+      continue;
+    }
+    svgWriteBytes(w, run, (size_t)(p - run));
+    p++;
+    // "%.Nf": casas fixas; usa snprintf para arredondar exatamente como o
+    // printf nos casos de empate (o log TXT tem de sair igual)
+    int fixed = -1;
+    if (*p == '.' && p[1] >= '0' && p[1] <= '9' && p[2] == 'f') {
+      fixed = p[1] - '0';
+      p += 2;
+    }
+    switch (*p) {
+    case 'f':
+      if (fixed >= 0) {
+        char num[SVG_NUM_MAX];
+        int len = snprintf(num, sizeof(num), "%.*f", fixed, va_arg(args, double));
+        if (len > 0)
+          svgWriteBytes(w, num, len < SVG_NUM_MAX ? (size_t)len : SVG_NUM_MAX - 1);
+      } else {
+        svgWriteNum(w, va_arg(args, double));
+      }
+      break;
+    case 'd': {
+      int v = va_arg(args, int);
+      char num[SVG_NUM_MAX];
+      char *q = num;
+      if (v < 0)
+        *q++ = '-';
+      q = formatUnsigned(q, v < 0 ? -(unsigned long long)v : (unsigned long long)v);
+      svgWriteBytes(w, num, (size_t)(q - num));
+      break;
+    }
+    case 's':
+      svgWriteStr(w, va_arg(args, const char *));
+      break;
+    case 'c': {
+      char c = (char)va_arg(args, int);
+      svgWriteBytes(w, &c, 1);
+      break;
+    }
+    case '%':
+      svgWriteBytes(w, "%", 1);
+      break;
+    default:
+      // Especificador desconhecido: escreve como está
+      svgWriteBytes(w, p - 1, *p ? 2 : 1);
+      break;
+    }
+    if (*p)
+      p++;
+    run = p;
+  }
+  svgWriteBytes(w, run, (size_t)(p - run));
+  va_end(args);
+}
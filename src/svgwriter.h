@@ -0,0 +1,146 @@
+#ifndef SVGWRITER_H
+#define SVGWRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * @brief Tipo opaco para um escritor de SVG com buffer próprio.
+ * Todos os emissores de SVG (svg.c, vis.c, qry.c) e o log TXT escrevem
+ * através dele. Com a thread de escrita ativa (pipeline.h), os buffers cheios
+ * são entregues a ela em vez de escritos diretamente.
+ */
+typedef void *SvgWriter;
+
+/**
+ * @brief Casas decimais usadas por omissão nos números (igual a "%lf").
+ */
+#define SVG_DEFAULT_PRECISION 6
+
+/**
+ * @brief Abre um ficheiro para escrita e associa-lhe um escritor.
+ * O ficheiro é aberto por quem chama mesmo em modo assíncrono; só a escrita
+ * passa para a thread de escrita.
+ * @param path Caminho do ficheiro.
+ * @return O escritor, ou NULL se o ficheiro não puder ser aberto.
+ */
+SvgWriter svgWriterOpen(const char *path);
+
+/**
+ * @brief Define a compressão gzip dos ficheiros abertos com svgWriterOpen a
+ * partir daqui. Com compressão, ".svg" passa a ".svgz" e os restantes
+ * ficheiros ganham ".gz" (ver svgWriterOutputPath). Com a thread de escrita
+ * ativa, a compressão corre nela.
+ * @param level 0 desliga; 1 (mais rápido) a 9 (menor ficheiro).
+ */
+void svgWriterSetCompression(int level);
+
+/**
+ * @brief Obtém o nível de compressão atual (0 = sem compressão).
+ */
+int svgWriterGetCompression(void);
+
+/**
+ * @brief Obtém o caminho com que svgWriterOpen cria de facto o ficheiro,
+ * tendo em conta a compressão.
+ * @param path Caminho pedido.
+ * @param dest Recebe o caminho efetivo.
+ * @param size Tamanho de dest.
+ */
+void svgWriterOutputPath(const char *path, char *dest, size_t size);
+
+/**
+ * @brief Cria um escritor sobre um ficheiro já aberto. O ficheiro não é
+ * fechado por svgWriterClose e nunca é comprimido.
+ * @param file Ficheiro aberto para escrita.
+ * @return O escritor, ou NULL se a alocação falhar.
+ */
+SvgWriter svgWriterInit(FILE *file);
+
+/**
+ * @brief Cria um escritor em memória, cujo buffer cresce conforme necessário.
+ * O conteúdo é obtido com svgWriterData.
+ * @return O escritor, ou NULL se a alocação falhar.
+ */
+SvgWriter svgWriterInitMemory(void);
+
+/**
+ * @brief Obtém o conteúdo de um escritor em memória.
+ * @param w O escritor.
+ * @param len Recebe a quantidade de bytes escritos.
+ * @return Os bytes (sem '\0' final), ou NULL se w não for em memória. Válido
+ * até à próxima escrita, svgWriterReset ou svgWriterClose.
+ */
+const char *svgWriterData(SvgWriter w, size_t *len);
+
+/**
+ * @brief Descarta o conteúdo de um escritor em memória.
+ * @param w O escritor.
+ */
+void svgWriterReset(SvgWriter w);
+
+/**
+ * @brief Descarrega o buffer, fecha o ficheiro (se foi aberto pelo escritor)
+ * e liberta o escritor.
+ * @param w O escritor.
+ */
+void svgWriterClose(SvgWriter w);
+
+/**
+ * @brief Descarrega o conteúdo do buffer para o ficheiro.
+ * @param w O escritor.
+ */
+void svgWriterFlush(SvgWriter w);
+
+/**
+ * @brief Define as casas decimais dos escritores criados a partir daqui.
+ * @param digits Número de casas decimais (limitado a [0, 9]).
+ */
+void svgWriterSetDefaultPrecision(int digits);
+
+/**
+ * @brief Define as casas decimais de um escritor.
+ * @param w O escritor.
+ * @param digits Número de casas decimais (limitado a [0, 9]).
+ */
+void svgWriterSetPrecision(SvgWriter w, int digits);
+
+/**
+ * @brief Obtém as casas decimais de um escritor.
+ * @param w O escritor.
+ * @return As casas decimais (a precisão por omissão se w for NULL).
+ */
+int svgWriterGetPrecision(SvgWriter w);
+
+/**
+ * @brief Escreve bytes sem formatação.
+ * @param w O escritor.
+ * @param data Os bytes.
+ * @param len Quantidade de bytes.
+ */
+void svgWriteBytes(SvgWriter w, const char *data, size_t len);
+
+/**
+ * @brief Escreve uma string terminada em '\0'.
+ * @param w O escritor.
+ * @param s A string.
+ */
+void svgWriteStr(SvgWriter w, const char *s);
+
+/**
+ * @brief Escreve um número com a precisão do escritor, sem zeros finais.
+ * @param w O escritor.
+ * @param v O valor.
+ */
+void svgWriteNum(SvgWriter w, double v);
+
+/**
+ * @brief Escrita formatada, sem locale. Aceita apenas %f (double, com a
+ * precisão do escritor e sem zeros finais), %.Nf (N casas fixas, com N de 0
+ * a 9), %d, %s, %c e %%.
+ * @param w O escritor.
+ * @param fmt A string de formato.
+ */
+void svgWritef(SvgWriter w, const char *fmt, ...);
+
+#endif // SVGWRITER_H
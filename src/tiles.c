@@ -0,0 +1,405 @@
+#include "tiles.h"
+#include "figure.h"
+#include "svg.h"
+#include "stats.h"
+#include "svgwriter.h"
+#include "trace.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A mesma margem que a varredura usa à volta da cena
+#define TILES_MARGIN 20.0
+#define TILES_MAX_THREADS 64
+
+// Elemento de sobreposição e a sua caixa
+typedef struct {
+  char *data;
+  size_t len;
+  double minX, minY, maxX, maxY;
+} Overlay;
+
+// O que o tile tinha quando foi escrito pela última vez
+typedef struct {
+  bool written;
+  int figures;
+  int overlays;
+  unsigned long version; // maior figureVersion entre as figuras do tile
+} TileState;
+
+// Conteúdo de um tile a (re)escrever
+typedef struct {
+  int level, tx, ty;
+  int *figs; // índices em g_items
+  int figCount;
+  int *ovs; // índices em g_overlays
+  int ovCount;
+  TileState state; // registado em g_state só se a escrita correr bem
+  bool ok;
+} TileJob;
+
+static char *g_stem = NULL;
+static int g_levels = 0;
+static int g_threads = 1;
+static double g_x0, g_y0, g_size;
+static TileState *g_state[TILES_MAX_LEVELS];
+static Overlay *g_overlays = NULL;
+static int g_overlayCount = 0, g_overlayCapacity = 0;
+
+// Figuras da atualização em curso, partilhadas (só leitura) pelas threads
+static Figure *g_items = NULL;
+
+bool tilesIsActive(void) { return g_stem != NULL; }
+
+bool tilesInit(const char *stem, FigureBounds bounds, int levels, int threads) {
+  tilesFree();
+  if (!stem || levels < 1)
+    return false;
+  if (levels > TILES_MAX_LEVELS)
+    levels = TILES_MAX_LEVELS;
+
+  double minX, minY, maxX, maxY;
+  if (!figureBoundsGet(bounds, &minX, &minY, &maxX, &maxY))
+    return false;
+  g_x0 = minX - TILES_MARGIN;
+  g_y0 = minY - TILES_MARGIN;
+  double w = maxX - minX + 2 * TILES_MARGIN;
+  double h = maxY - minY + 2 * TILES_MARGIN;
+  g_size = w > h ? w : h;
+
+  for (int z = 0; z < levels; z++) {
+    int n = 1 << z;
+    g_state[z] = calloc((size_t)n * n, sizeof(TileState));
+    if (!g_state[z]) {
+      g_levels = z;
+      tilesFree();
+      return false;
+    }
+  }
+  g_stem = malloc(strlen(stem) + 1);
+  if (!g_stem) {
+    g_levels = levels;
+    tilesFree();
+    return false;
+  }
+  strcpy(g_stem, stem);
+  g_levels = levels;
+  g_threads = threads < 1 ? 1 : threads;
+  if (g_threads > TILES_MAX_THREADS)
+    g_threads = TILES_MAX_THREADS;
+  return true;
+}
+
+void tilesAddOverlay(const char *data, size_t len, double minX, double minY,
+                     double maxX, double maxY) {
+  if (!g_stem)
+    return;
+  if (g_overlayCount == g_overlayCapacity) {
+    int capacity = g_overlayCapacity ? g_overlayCapacity * 2 : 64;
+    Overlay *overlays = realloc(g_overlays, sizeof(Overlay) * capacity);
+    if (!overlays)
+      return;
+    g_overlays = overlays;
+    g_overlayCapacity = capacity;
+  }
+  Overlay *o = &g_overlays[g_overlayCount];
+  o->data = malloc(len);
+  if (!o->data)
+    return;
+  memcpy(o->data, data, len);
+  o->len = len;
+  o->minX = minX;
+  o->minY = minY;
+  o->maxX = maxX;
+  o->maxY = maxY;
+  g_overlayCount++;
+}
+
+// Intervalo de tiles [x0, x1] x [y0, y1] que a caixa toca no nível com n x n
+// tiles; false se a caixa estiver fora da grelha
+static bool tileRange(int n, double minX, double minY, double maxX,
+                      double maxY, int *x0, int *y0, int *x1, int *y1) {
+  double tile = g_size / n;
+  *x0 = (int)floor((minX - g_x0) / tile);
+  *y0 = (int)floor((minY - g_y0) / tile);
+  *x1 = (int)floor((maxX - g_x0) / tile);
+  *y1 = (int)floor((maxY - g_y0) / tile);
+  if (*x1 < 0 || *y1 < 0 || *x0 >= n || *y0 >= n)
+    return false;
+  if (*x0 < 0)
+    *x0 = 0;
+  if (*y0 < 0)
+    *y0 = 0;
+  if (*x1 >= n)
+    *x1 = n - 1;
+  if (*y1 >= n)
+    *y1 = n - 1;
+  return true;
+}
+
+// Caixa da figura, ou false se ela deve ser omitida no nível (sub-pixel)
+static bool figureBox(Figure f, double pixel, double *box) {
+  if (!figureGetExtent(f, &box[0], &box[1], &box[2], &box[3]))
+    return false;
+  return box[2] - box[0] >= pixel || box[3] - box[1] >= pixel;
+}
+
+static bool writeTile(const TileJob *job) {
+  int n = 1 << job->level;
+  double tile = g_size / n;
+  SvgWriter out = svgWriterInitMemory();
+  if (!out)
+    return false;
+
+  svgWritef(out,
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" "
+            "width=\"%d\" height=\"%d\" viewBox=\"%f %f %f %f\">\n",
+            TILES_PIXELS, TILES_PIXELS, g_x0 + job->tx * tile,
+            g_y0 + job->ty * tile, tile, tile);
+  // As caches já foram preenchidas: aqui só são lidas
+  for (int i = 0; i < job->figCount; i++)
+    svgDrawFigure(out, g_items[job->figs[i]]);
+  for (int i = 0; i < job->ovCount; i++) {
+    const Overlay *o = &g_overlays[job->ovs[i]];
+    svgWriteBytes(out, o->data, o->len);
+  }
+  svgClose(out);
+
+  // Escrita direta: a thread de escrita só aceita um produtor
+  char path[1024];
+  snprintf(path, sizeof(path), "%s-tile-%d-%d-%d.svg", g_stem, job->level,
+           job->tx, job->ty);
+  bool ok = false;
+  FILE *f = fopen(path, "w");
+  if (f) {
+    size_t len;
+    const char *data = svgWriterData(out, &len);
+    ok = fwrite(data, 1, len, f) == len;
+    if (fclose(f) != 0)
+      ok = false;
+    if (!ok)
+      fprintf(stderr, "ERRO: Falha ao escrever %s\n", path);
+  } else {
+    fprintf(stderr, "ERRO: Não foi possível abrir %s\n", path);
+  }
+  svgWriterClose(out);
+  return ok;
+}
+
+typedef struct {
+  TileJob *jobs;
+  int count;
+  int next;
+  pthread_mutex_t lock;
+} TileQueue;
+
+static void *tileWorker(void *arg) {
+  TileQueue *q = (TileQueue *)arg;
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    int i = q->next++;
+    pthread_mutex_unlock(&q->lock);
+    if (i >= q->count)
+      return NULL;
+    traceBeginArg("tile", "tiles", "nivel", q->jobs[i].level);
+    TileJob *job = &q->jobs[i];
+    // ok já é false se o conteúdo ficou incompleto
+    job->ok = job->ok && writeTile(job);
+    traceEnd();
+  }
+}
+
+// Acrescenta o índice idx à lista do tile (as listas crescem em dobro)
+static bool appendIndex(int **list, int *count, int idx) {
+  if ((*count & (*count - 1)) == 0) {
+    int capacity = *count ? *count * 2 : 4;
+    int *grown = realloc(*list, sizeof(int) * capacity);
+    if (!grown)
+      return false;
+    *list = grown;
+  }
+  (*list)[(*count)++] = idx;
+  return true;
+}
+
+int tilesUpdate(List figures) {
+  if (!g_stem)
+    return 0;
+  int count;
+  g_items = (Figure *)listToArray(figures, &count);
+  if (!g_items && count > 0)
+    return 0;
+  // Figuras presentes em algum tile a escrever (só essas aquecem a cache)
+  bool *used = calloc((size_t)count + 1, sizeof(bool));
+  if (!used) {
+    TED_FREE(g_items);
+    g_items = NULL;
+    return 0;
+  }
+  traceBegin("tilesUpdate", "tiles");
+
+  TileJob *jobs = NULL;
+  int jobCount = 0, jobCapacity = 0;
+  for (int z = 0; z < g_levels; z++) {
+    int n = 1 << z;
+    int tiles = n * n;
+    // Só o último nível mantém as figuras menores que um pixel
+    double pixel = z == g_levels - 1 ? 0.0 : g_size / n / TILES_PIXELS;
+
+    // 1. Resumo do conteúdo atual de cada tile
+    TileState *now = calloc((size_t)tiles, sizeof(TileState));
+    if (!now)
+      break;
+    double box[4];
+    int x0, y0, x1, y1;
+    for (int i = 0; i < count; i++) {
+      if (!figureBox(g_items[i], pixel, box) ||
+          !tileRange(n, box[0], box[1], box[2], box[3], &x0, &y0, &x1, &y1))
+        continue;
+      unsigned long version = figureVersion(g_items[i]);
+      for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++) {
+          TileState *t = &now[ty * n + tx];
+          t->figures++;
+          if (version > t->version)
+            t->version = version;
+        }
+      }
+    }
+    for (int i = 0; i < g_overlayCount; i++) {
+      Overlay *o = &g_overlays[i];
+      if (!tileRange(n, o->minX, o->minY, o->maxX, o->maxY, &x0, &y0, &x1, &y1))
+        continue;
+      for (int ty = y0; ty <= y1; ty++)
+        for (int tx = x0; tx <= x1; tx++)
+          now[ty * n + tx].overlays++;
+    }
+
+    // 2. Tiles cujo resumo mudou
+    int *jobOf = malloc(sizeof(int) * tiles);
+    if (!jobOf) {
+      free(now);
+      break;
+    }
+    for (int t = 0; t < tiles; t++)
+      jobOf[t] = -1;
+    for (int t = 0; t < tiles; t++) {
+      TileState *old = &g_state[z][t];
+      if (old->written && old->figures == now[t].figures &&
+          old->overlays == now[t].overlays && old->version == now[t].version)
+        continue;
+      if (jobCount == jobCapacity) {
+        jobCapacity = jobCapacity ? jobCapacity * 2 : 64;
+        TileJob *grown = realloc(jobs, sizeof(TileJob) * jobCapacity);
+        if (!grown)
+          break;
+        jobs = grown;
+      }
+      TileJob *job = &jobs[jobCount];
+      memset(job, 0, sizeof(TileJob));
+      job->level = z;
+      job->tx = t % n;
+      job->ty = t / n;
+      job->state = now[t];
+      job->state.written = true;
+      job->ok = true;
+      jobOf[t] = jobCount++;
+    }
+
+    // 3. Conteúdo dos tiles a escrever, pela ordem da lista de figuras
+    for (int i = 0; i < count; i++) {
+      if (!figureBox(g_items[i], pixel, box) ||
+          !tileRange(n, box[0], box[1], box[2], box[3], &x0, &y0, &x1, &y1))
+        continue;
+      for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++) {
+          int j = jobOf[ty * n + tx];
+          if (j >= 0) {
+            if (!appendIndex(&jobs[j].figs, &jobs[j].figCount, i))
+              jobs[j].ok = false;
+            used[i] = true;
+          }
+        }
+      }
+    }
+    for (int i = 0; i < g_overlayCount; i++) {
+      Overlay *o = &g_overlays[i];
+      if (!tileRange(n, o->minX, o->minY, o->maxX, o->maxY, &x0, &y0, &x1, &y1))
+        continue;
+      for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++) {
+          int j = jobOf[ty * n + tx];
+          if (j >= 0 && !appendIndex(&jobs[j].ovs, &jobs[j].ovCount, i))
+            jobs[j].ok = false;
+        }
+      }
+    }
+    free(jobOf);
+    free(now);
+  }
+
+  if (jobCount > 0) {
+    // Uma figura pode estar em vários tiles: as caches são preenchidas aqui,
+    // numa só thread, para que as threads dos tiles apenas as leiam
+    SvgWriter scratch = svgWriterInitMemory();
+    for (int i = 0; i < count && scratch; i++) {
+      if (!used[i])
+        continue;
+      svgDrawFigure(scratch, g_items[i]);
+      svgWriterReset(scratch);
+    }
+    svgWriterClose(scratch);
+
+    TileQueue q = {jobs, jobCount, 0, PTHREAD_MUTEX_INITIALIZER};
+    pthread_t ids[TILES_MAX_THREADS];
+    int started = 0;
+    int wanted = g_threads < jobCount ? g_threads : jobCount;
+    for (int t = 1; t < wanted; t++) {
+      if (pthread_create(&ids[started], NULL, tileWorker, &q) != 0)
+        break;
+      started++;
+    }
+    tileWorker(&q);
+    for (int t = 0; t < started; t++)
+      pthread_join(ids[t], NULL);
+  }
+
+  // O estado só avança nos tiles escritos; os outros voltam a ser tentados
+  int written = 0;
+  for (int j = 0; j < jobCount; j++) {
+    int n = 1 << jobs[j].level;
+    TileState *slot = &g_state[jobs[j].level][jobs[j].ty * n + jobs[j].tx];
+    if (jobs[j].ok) {
+      *slot = jobs[j].state;
+      written++;
+    } else {
+      slot->written = false;
+    }
+    free(jobs[j].figs);
+    free(jobs[j].ovs);
+  }
+  free(jobs);
+  free(used);
+  TED_FREE(g_items);
+  g_items = NULL;
+  traceEnd();
+  return written;
+}
+
+void tilesFree(void) {
+  for (int z = 0; z < g_levels; z++) {
+    free(g_state[z]);
+    g_state[z] = NULL;
+  }
+  for (int i = 0; i < g_overlayCount; i++)
+    free(g_overlays[i].data);
+  free(g_overlays);
+  g_overlays = NULL;
+  g_overlayCount = g_overlayCapacity = 0;
+  free(g_stem);
+  g_stem = NULL;
+  g_levels = 0;
+}
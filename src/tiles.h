@@ -0,0 +1,61 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include "figure.h"
+#include "list.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Lado, em pixels, com que cada tile é desenhado (atributos width e
+ * height do SVG). Define o que é uma figura "sub-pixel" em cada nível.
+ */
+#define TILES_PIXELS 256
+
+/**
+ * @brief Ativa a saída em tiles sobre os limites atuais da cena (mais uma
+ * margem). No nível z a cena é dividida em 2^z x 2^z tiles, cada um escrito
+ * em "<stem>-tile-<z>-<x>-<y>.svg". Deve ser chamada depois de lido o .geo.
+ * @param stem Caminho dos ficheiros, sem extensão.
+ * @param bounds Caixa envolvente da cena.
+ * @param levels Número de níveis de zoom (1 a TILES_MAX_LEVELS).
+ * @param threads Threads usadas para gerar os tiles (1 = sequencial).
+ * @return true se a saída em tiles ficou ativa.
+ */
+bool tilesInit(const char *stem, FigureBounds bounds, int levels, int threads);
+
+#define TILES_MAX_LEVELS 10
+
+/**
+ * @brief Indica se a saída em tiles está ativa.
+ */
+bool tilesIsActive(void);
+
+/**
+ * @brief Acrescenta um elemento de sobreposição (marcador, polígono de
+ * visibilidade) que passa a aparecer em todos os tiles que a sua caixa toca,
+ * em todos os níveis. Os bytes são copiados.
+ * @param data O SVG do elemento.
+ * @param len Quantidade de bytes.
+ * @param minX, minY, maxX, maxY Caixa envolvente do elemento.
+ */
+void tilesAddOverlay(const char *data, size_t len, double minX, double minY,
+                     double maxX, double maxY);
+
+/**
+ * @brief Reescreve os tiles cujo conteúdo mudou desde a última chamada:
+ * figuras alteradas (figureVersion), figuras que entraram ou saíram e novas
+ * sobreposições. Nos níveis mais grosseiros as figuras menores que um pixel
+ * são omitidas; o último nível tem todas.
+ * @param figures As figuras da cena.
+ * @return Número de tiles escritos com sucesso; os que falharem são
+ * reescritos na chamada seguinte.
+ */
+int tilesUpdate(List figures);
+
+/**
+ * @brief Liberta o estado dos tiles e desativa a saída em tiles.
+ */
+void tilesFree(void);
+
+#endif // TILES_H
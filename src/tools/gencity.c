@@ -0,0 +1,349 @@
+// Gera cidades sintéticas (.geo) e consultas (.qry) de tamanho arbitrário,
+// para testes de escala e benchmarks. A saída depende apenas dos parâmetros e
+// da semente: o gerador aleatório é próprio e da libm só se usa sqrt (exata),
+// por isso os ficheiros são idênticos em qualquer máquina.
+//
+// Uso: tools/gencity -o <prefixo> [-n figuras] [-dist uniforme|cluster|grelha|muros]
+//                    [-mix c,r,l,t] [-side lado] [-seed semente]
+//                    [-q comandos] [-cmds a,d,p,cln] [-loc 0..1] [-sfx 0..1]
+//
+// Escreve <prefixo>.geo e, com -q > 0, <prefixo>.qry.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIST_UNIFORM 0
+#define DIST_CLUSTER 1
+#define DIST_GRID 2
+#define DIST_WALLS 3
+
+// Figuras por aglomerado na distribuição cluster
+#define GEN_CLUSTER_SIZE 200
+// Lado de um quarteirão e largura das ruas na distribuição grelha
+#define GEN_BLOCK 60.0
+#define GEN_STREET 12.0
+
+typedef struct {
+  const char *prefix;
+  int figures;
+  int dist;
+  int mix[4];
+  double side;
+  uint64_t seed;
+  int commands;
+  int cmds[4];
+  double locality;
+  double suffix;
+} Options;
+
+static const char *g_distNames[] = {"uniforme", "cluster", "grelha", "muros"};
+
+static const char *g_colors[] = {"#ff0000", "#00aa00", "#0000ff", "#aa00aa",
+                                 "#ff8800", "#008888"};
+#define GEN_COLOR_COUNT (int)(sizeof(g_colors) / sizeof(g_colors[0]))
+
+// --- Gerador Aleatório ---
+
+// splitmix64: simples, rápido e com o mesmo resultado em qualquer plataforma
+static uint64_t g_state;
+
+static uint64_t rndNext(void) {
+  uint64_t z = (g_state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Uniforme em [0, 1)
+static double rnd(void) { return (rndNext() >> 11) * (1.0 / 9007199254740992.0); }
+
+static double rndRange(double lo, double hi) { return lo + rnd() * (hi - lo); }
+
+static int rndInt(int n) { return (int)(rnd() * n); }
+
+// Aproximadamente normal (média 0, desvio 1) pela soma de 12 uniformes, para
+// não depender da libm
+static double rndNormal(void) {
+  double s = 0;
+  for (int i = 0; i < 12; i++)
+    s += rnd();
+  return s - 6.0;
+}
+
+// Escolhe um índice com probabilidade proporcional ao peso
+static int rndWeighted(const int *weights, int count) {
+  int total = 0;
+  for (int i = 0; i < count; i++)
+    total += weights[i];
+  int r = rndInt(total);
+  for (int i = 0; i < count; i++) {
+    if (r < weights[i])
+      return i;
+    r -= weights[i];
+  }
+  return count - 1;
+}
+
+static double clamp(double v, double lo, double hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// --- Cidade ---
+
+typedef struct {
+  double x, y;
+} Center;
+
+// Posição de uma figura segundo a distribuição escolhida
+static void placeFigure(const Options *o, const Center *centers, int centerCount,
+                        double *x, double *y) {
+  switch (o->dist) {
+  case DIST_CLUSTER: {
+    const Center *c = &centers[rndInt(centerCount)];
+    double spread = o->side * 0.03;
+    *x = clamp(c->x + rndNormal() * spread, 0, o->side);
+    *y = clamp(c->y + rndNormal() * spread, 0, o->side);
+    break;
+  }
+  case DIST_GRID: {
+    // Um lote dentro de um quarteirão, nunca sobre a rua
+    double pitch = GEN_BLOCK + GEN_STREET;
+    int blocks = (int)(o->side / pitch);
+    if (blocks < 1)
+      blocks = 1;
+    *x = rndInt(blocks) * pitch + GEN_STREET + rnd() * (GEN_BLOCK - 10);
+    *y = rndInt(blocks) * pitch + GEN_STREET + rnd() * (GEN_BLOCK - 10);
+    break;
+  }
+  default:
+    *x = rnd() * o->side;
+    *y = rnd() * o->side;
+    break;
+  }
+}
+
+static void writeFigure(FILE *f, const Options *o, int id, int shape, double x,
+                        double y) {
+  bool grid = o->dist == DIST_GRID;
+  switch (shape) {
+  case 0:
+    fprintf(f, "c %d %.2f %.2f %.2f #000000 #ccbbaa\n", id, x, y,
+            rndRange(1, grid ? 5 : 8));
+    break;
+  case 1:
+    if (grid)
+      fprintf(f, "r %d %.2f %.2f %.2f %.2f #000000 #aabbcc\n", id, x, y,
+              rndRange(4, 10), rndRange(4, 10));
+    else
+      fprintf(f, "r %d %.2f %.2f %.2f %.2f #000000 #aabbcc\n", id, x, y,
+              rndRange(2, 22), rndRange(2, 22));
+    break;
+  case 2: {
+    double x2, y2;
+    if (o->dist == DIST_WALLS) {
+      // Muro comprido, horizontal ou vertical, a atravessar parte da cidade
+      double len = rndRange(0.2, 0.6) * o->side;
+      bool horizontal = rnd() < 0.5;
+      x2 = clamp(horizontal ? x + len : x, 0, o->side);
+      y2 = clamp(horizontal ? y : y + len, 0, o->side);
+    } else if (grid) {
+      // Muro ao longo de um lado do lote
+      bool horizontal = rnd() < 0.5;
+      x2 = horizontal ? x + 10 : x;
+      y2 = horizontal ? y : y + 10;
+    } else {
+      x2 = x + rndRange(-15, 15);
+      y2 = y + rndRange(-15, 15);
+    }
+    fprintf(f, "l %d %.2f %.2f %.2f %.2f #0000ff\n", id, x, y, x2, y2);
+    break;
+  }
+  default:
+    fprintf(f, "t %d %.2f %.2f #000000 #00ff00 m alvo%d\n", id, x, y, id);
+    break;
+  }
+}
+
+static bool writeGeo(const Options *o, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+
+  int centerCount = o->figures / GEN_CLUSTER_SIZE + 1;
+  Center *centers = malloc(centerCount * sizeof(Center));
+  if (!centers) {
+    fclose(f);
+    return false;
+  }
+  for (int i = 0; i < centerCount; i++) {
+    centers[i].x = rndRange(0.1, 0.9) * o->side;
+    centers[i].y = rndRange(0.1, 0.9) * o->side;
+  }
+
+  fprintf(f, "ts sans-serif n 8\n");
+  for (int id = 1; id <= o->figures; id++) {
+    double x, y;
+    placeFigure(o, centers, centerCount, &x, &y);
+    writeFigure(f, o, id, rndWeighted(o->mix, 4), x, y);
+  }
+
+  free(centers);
+  return fclose(f) == 0;
+}
+
+// --- Consultas ---
+
+static bool writeQry(const Options *o, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+
+  // Com probabilidade "locality" o ponto seguinte cai perto do anterior
+  double px = o->side / 2, py = o->side / 2;
+  int lastId = 1;
+  int sfxCount = 0;
+  for (int i = 0; i < o->commands; i++) {
+    bool near = rnd() < o->locality;
+    if (near) {
+      double spread = o->side * 0.02;
+      px = clamp(px + rndNormal() * spread, 0, o->side);
+      py = clamp(py + rndNormal() * spread, 0, o->side);
+    } else {
+      px = rnd() * o->side;
+      py = rnd() * o->side;
+    }
+
+    char sfx[32] = "-";
+    if (rnd() < o->suffix)
+      snprintf(sfx, sizeof(sfx), "s%d", ++sfxCount);
+
+    switch (rndWeighted(o->cmds, 4)) {
+    case 0: {
+      // Intervalo de ids, vizinho do anterior quando há localidade
+      int span = rndInt(o->figures / 50 + 1) + 1;
+      int start = near ? lastId + rndInt(2 * span + 1) - span
+                       : rndInt(o->figures) + 1;
+      if (start < 1)
+        start = 1;
+      lastId = start;
+      fprintf(f, "a %d %d %c\n", start, start + span, rnd() < 0.5 ? 'h' : 'v');
+      break;
+    }
+    case 1:
+      fprintf(f, "d %.2f %.2f %s\n", px, py, sfx);
+      break;
+    case 2:
+      fprintf(f, "p %.2f %.2f %s %s\n", px, py,
+              g_colors[rndInt(GEN_COLOR_COUNT)], sfx);
+      break;
+    default:
+      fprintf(f, "cln %.2f %.2f %.2f %.2f %s\n", px, py, rndRange(-20, 20),
+              rndRange(-20, 20), sfx);
+      break;
+    }
+  }
+  return fclose(f) == 0;
+}
+
+// --- Argumentos ---
+
+static bool parseWeights(const char *s, int *out) {
+  int w[4];
+  if (sscanf(s, "%d,%d,%d,%d", &w[0], &w[1], &w[2], &w[3]) != 4)
+    return false;
+  int total = 0;
+  for (int i = 0; i < 4; i++) {
+    if (w[i] < 0)
+      return false;
+    total += w[i];
+  }
+  if (total == 0)
+    return false;
+  memcpy(out, w, sizeof(w));
+  return true;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "uso: %s -o <prefixo> [-n figuras] [-dist uniforme|cluster|grelha|muros]\n"
+          "         [-mix c,r,l,t] [-side lado] [-seed semente]\n"
+          "         [-q comandos] [-cmds a,d,p,cln] [-loc 0..1] [-sfx 0..1]\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  Options o = {NULL, 1000, DIST_UNIFORM, {1, 1, 1, 1}, 0, 1, 0,
+               {1, 3, 3, 1}, 0.5, 0.1};
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "-o") == 0 && hasValue) {
+      o.prefix = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0 && hasValue) {
+      o.figures = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-dist") == 0 && hasValue) {
+      const char *name = argv[++i];
+      o.dist = -1;
+      for (int d = 0; d < 4; d++)
+        if (strcmp(name, g_distNames[d]) == 0)
+          o.dist = d;
+      if (o.dist < 0) {
+        fprintf(stderr, "ERRO: Distribuição desconhecida: %s\n", name);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-mix") == 0 && hasValue) {
+      if (!parseWeights(argv[++i], o.mix)) {
+        fprintf(stderr, "ERRO: -mix espera quatro pesos c,r,l,t\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-side") == 0 && hasValue) {
+      o.side = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-seed") == 0 && hasValue) {
+      o.seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-q") == 0 && hasValue) {
+      o.commands = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-cmds") == 0 && hasValue) {
+      if (!parseWeights(argv[++i], o.cmds)) {
+        fprintf(stderr, "ERRO: -cmds espera quatro pesos a,d,p,cln\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-loc") == 0 && hasValue) {
+      o.locality = clamp(atof(argv[++i]), 0, 1);
+    } else if (strcmp(argv[i], "-sfx") == 0 && hasValue) {
+      o.suffix = clamp(atof(argv[++i]), 0, 1);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!o.prefix || o.figures < 1 || o.commands < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  // Por omissão a densidade é constante, como em bench/bench
+  if (o.side <= 0)
+    o.side = 20.0 * sqrt((double)o.figures);
+  g_state = o.seed;
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s.geo", o.prefix);
+  if (!writeGeo(&o, path)) {
+    fprintf(stderr, "ERRO: Não foi possível escrever %s\n", path);
+    return 1;
+  }
+  if (o.commands > 0) {
+    snprintf(path, sizeof(path), "%s.qry", o.prefix);
+    if (!writeQry(&o, path)) {
+      fprintf(stderr, "ERRO: Não foi possível escrever %s\n", path);
+      return 1;
+    }
+  }
+  fprintf(stderr, "%d figuras (%s, lado %.1f), %d comandos, semente %llu\n",
+          o.figures, g_distNames[o.dist], o.side, o.commands,
+          (unsigned long long)o.seed);
+  return 0;
+}
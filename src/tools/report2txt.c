@@ -0,0 +1,48 @@
+// Regenera o relatório de texto (o .txt de sempre) a partir de um relatório
+// CSV ou binário gravado com -rel csv / -rel bin.
+//
+// Uso: tools/report2txt <relatório> [saída.txt]
+
+#include "report.h"
+#include "svgwriter.h"
+
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "uso: %s <relatório> [saída.txt]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    fprintf(stderr, "ERRO: Não foi possível abrir %s\n", argv[1]);
+    return 1;
+  }
+  int format = reportReadHeader(in);
+  if (format < 0) {
+    fprintf(stderr, "ERRO: %s não é um relatório CSV nem binário\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+
+  SvgWriter out = argc > 2 ? svgWriterOpen(argv[2]) : svgWriterInit(stdout);
+  if (!out) {
+    fprintf(stderr, "ERRO: Não foi possível abrir %s\n", argv[2]);
+    fclose(in);
+    return 1;
+  }
+
+  ReportRecord rec;
+  while (reportRead(in, format, &rec))
+    reportFormatText(out, &rec);
+  bool complete = feof(in);
+
+  svgWriterClose(out);
+  fclose(in);
+  if (!complete) {
+    fprintf(stderr, "ERRO: registo inválido em %s\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Intervalos guardados por thread (os mais antigos são substituídos)
+#define TRACE_RING_SIZE 32768
+// Profundidade máxima de intervalos abertos ao mesmo tempo numa thread
+#define TRACE_MAX_DEPTH 32
+// Buffers distintos; as threads que terminam devolvem o seu para reutilização
+#define TRACE_MAX_BUFFERS 64
+
+typedef struct {
+  const char *name;
+  const char *category;
+  const char *argName;
+  long arg;
+  uint64_t start;
+  uint64_t duration;
+} TraceEvent;
+
+typedef struct {
+  int tid;
+  const char *threadName;
+  bool inUse;
+  TraceEvent ring[TRACE_RING_SIZE];
+  uint64_t written;
+  TraceEvent open[TRACE_MAX_DEPTH];
+  int depth;
+} TraceBuffer;
+
+static bool g_active = false;
+static FILE *g_file = NULL;
+static struct timespec g_origin;
+static TraceBuffer *g_buffers[TRACE_MAX_BUFFERS];
+static int g_bufferCount = 0;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_key;
+static _Thread_local TraceBuffer *t_buffer = NULL;
+
+static uint64_t nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)(ts.tv_sec - g_origin.tv_sec) * 1000000000ull +
+         (uint64_t)ts.tv_nsec - (uint64_t)g_origin.tv_nsec;
+}
+
+// Chamado à saída de cada thread: o buffer fica livre para a próxima
+static void releaseBuffer(void *arg) {
+  TraceBuffer *b = (TraceBuffer *)arg;
+  pthread_mutex_lock(&g_lock);
+  b->inUse = false;
+  b->depth = 0;
+  pthread_mutex_unlock(&g_lock);
+}
+
+static TraceBuffer *threadBuffer(void) {
+  if (t_buffer)
+    return t_buffer;
+  pthread_mutex_lock(&g_lock);
+  TraceBuffer *b = NULL;
+  for (int i = 0; i < g_bufferCount && !b; i++)
+    if (!g_buffers[i]->inUse)
+      b = g_buffers[i];
+  if (!b && g_bufferCount < TRACE_MAX_BUFFERS) {
+    b = malloc(sizeof(TraceBuffer));
+    if (b) {
+      b->tid = g_bufferCount + 1;
+      b->threadName = NULL;
+      b->written = 0;
+      b->depth = 0;
+      g_buffers[g_bufferCount++] = b;
+    }
+  }
+  if (b) {
+    b->inUse = true;
+    b->threadName = NULL;
+  }
+  pthread_mutex_unlock(&g_lock);
+  if (b) {
+    pthread_setspecific(g_key, b);
+    t_buffer = b;
+  }
+  return b;
+}
+
+bool traceOpen(const char *path) {
+  g_file = fopen(path, "w");
+  if (!g_file)
+    return false;
+  if (pthread_key_create(&g_key, releaseBuffer) != 0) {
+    fclose(g_file);
+    g_file = NULL;
+    return false;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &g_origin);
+  g_active = true;
+  traceSetThreadName("principal");
+  return true;
+}
+
+bool traceIsActive(void) { return g_active; }
+
+void traceSetThreadName(const char *name) {
+  if (!g_active)
+    return;
+  TraceBuffer *b = threadBuffer();
+  if (b)
+    b->threadName = name;
+}
+
+void traceBeginArg(const char *name, const char *category, const char *argName, long arg) {
+  if (!g_active)
+    return;
+  TraceBuffer *b = threadBuffer();
+  if (!b)
+    return;
+  if (b->depth < TRACE_MAX_DEPTH) {
+    TraceEvent *e = &b->open[b->depth];
+    e->name = name;
+    e->category = category;
+    e->argName = argName;
+    e->arg = arg;
+    e->start = nowNs();
+  }
+  b->depth++;
+}
+
+void traceBegin(const char *name, const char *category) {
+  traceBeginArg(name, category, NULL, 0);
+}
+
+void traceEnd(void) {
+  if (!g_active)
+    return;
+  TraceBuffer *b = t_buffer;
+  if (!b || b->depth == 0)
+    return;
+  b->depth--;
+  if (b->depth >= TRACE_MAX_DEPTH)
+    return;
+  TraceEvent e = b->open[b->depth];
+  e.duration = nowNs() - e.start;
+  b->ring[b->written % TRACE_RING_SIZE] = e;
+  b->written++;
+}
+
+static void writeEvent(const TraceEvent *e, int tid, bool *first) {
+  fprintf(g_file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                  "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+          *first ? "" : ",", e->name, e->category, tid, e->start / 1000.0,
+          e->duration / 1000.0);
+  if (e->argName)
+    fprintf(g_file, ",\"args\":{\"%s\":%ld}", e->argName, e->arg);
+  fputc('}', g_file);
+  *first = false;
+}
+
+void traceClose(void) {
+  if (!g_active)
+    return;
+  g_active = false;
+
+  fprintf(g_file, "{\"traceEvents\":[");
+  bool first = true;
+  uint64_t dropped = 0;
+  for (int i = 0; i < g_bufferCount; i++) {
+    TraceBuffer *b = g_buffers[i];
+    char name[32];
+    if (b->threadName)
+      snprintf(name, sizeof(name), "%s", b->threadName);
+    else
+      snprintf(name, sizeof(name), "trabalho %d", b->tid - 1);
+    fprintf(g_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",", b->tid, name);
+    first = false;
+
+    // Do mais antigo para o mais recente
+    uint64_t from = 0;
+    if (b->written > TRACE_RING_SIZE) {
+      from = b->written - TRACE_RING_SIZE;
+      dropped += from;
+    }
+    for (uint64_t k = from; k < b->written; k++)
+      writeEvent(&b->ring[k % TRACE_RING_SIZE], b->tid, &first);
+  }
+  fprintf(g_file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"descartados\":%llu}}\n",
+          (unsigned long long)dropped);
+  fclose(g_file);
+  g_file = NULL;
+
+  for (int i = 0; i < g_bufferCount; i++)
+    free(g_buffers[i]);
+  g_bufferCount = 0;
+  t_buffer = NULL;
+  pthread_setspecific(g_key, NULL);
+  pthread_key_delete(g_key);
+}
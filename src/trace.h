@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Ativa o registo de intervalos (spans), escritos em path no formato
+ * JSON de trace-events do Chrome (abre no Perfetto ou em chrome://tracing).
+ * Cada thread grava num buffer circular próprio; se encher, perdem-se os
+ * intervalos mais antigos dessa thread. Deve ser chamada antes de criadas
+ * outras threads.
+ * @return false se o ficheiro não puder ser criado.
+ */
+bool traceOpen(const char *path);
+
+/**
+ * @brief Indica se o trace está ativo.
+ */
+bool traceIsActive(void);
+
+/**
+ * @brief Dá nome à thread atual no trace (por omissão "trabalho N").
+ * @param name String estática.
+ */
+void traceSetThreadName(const char *name);
+
+/**
+ * @brief Abre um intervalo na thread atual. Sem efeito se o trace estiver
+ * inativo. Os intervalos fecham-se por ordem inversa com traceEnd.
+ * @param name Nome do intervalo (string estática).
+ * @param category Categoria (string estática).
+ */
+void traceBegin(const char *name, const char *category);
+
+/**
+ * @brief Como traceBegin, com um argumento numérico mostrado no visualizador.
+ * @param argName Nome do argumento (string estática).
+ * @param arg Valor.
+ */
+void traceBeginArg(const char *name, const char *category, const char *argName, long arg);
+
+/**
+ * @brief Fecha o último intervalo aberto na thread atual.
+ */
+void traceEnd(void);
+
+/**
+ * @brief Escreve o ficheiro e desativa o trace. Só deve ser chamada com as
+ * restantes threads já terminadas (depois de pipelineStop).
+ */
+void traceClose(void);
+
+#endif // TRACE_H
@@ -1,17 +1,30 @@
 #include "tree.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
 
+// Quantidade de nós alocados de uma vez pelo pool
+#define TREE_POOL_BLOCK 256
+
 typedef struct node {
     void *data;
     struct node *left;
     struct node *right;
+    struct node *parent;
     int height;
 } Node;
 
+typedef struct block {
+    struct block *next;
+    Node nodes[TREE_POOL_BLOCK];
+} NodeBlock;
+
 typedef struct {
     Node *root;
+    Node *min;
     TreeCmp compare;
+    Node *freeNodes;
+    NodeBlock *blocks;
 } TreeStruct;
 
 static int height(Node *n) {
@@ -23,38 +36,80 @@ static int max(int a, int b) {
     return (a > b) ? a : b;
 }
 
-static Node *newNode(void *data) {
-    Node *node = (Node *)malloc(sizeof(Node));
-    if (!node) return NULL;
+static void updateHeight(Node *n) {
+    n->height = max(height(n->left), height(n->right)) + 1;
+}
+
+// --- Pool de Nós ---
+
+static Node *newNode(TreeStruct *tree, void *data) {
+    if (tree->freeNodes == NULL) {
+        NodeBlock *block = (NodeBlock *)TED_MALLOC(sizeof(NodeBlock));
+        if (!block) return NULL;
+        block->next = tree->blocks;
+        tree->blocks = block;
+        // Encadeia os nós do bloco na free-list usando o ponteiro parent
+        for (int i = 0; i < TREE_POOL_BLOCK; i++) {
+            block->nodes[i].parent = tree->freeNodes;
+            tree->freeNodes = &block->nodes[i];
+        }
+    }
+    Node *node = tree->freeNodes;
+    tree->freeNodes = node->parent;
+
     node->data = data;
     node->left = NULL;
     node->right = NULL;
+    node->parent = NULL;
     node->height = 1;
     return node;
 }
 
-static Node *rightRotate(Node *y) {
+static void releaseNode(TreeStruct *tree, Node *node) {
+    node->data = NULL;
+    node->parent = tree->freeNodes;
+    tree->freeNodes = node;
+}
+
+// --- Rotações ---
+
+static void replaceChild(TreeStruct *tree, Node *parent, Node *oldChild, Node *newChild) {
+    if (parent == NULL) tree->root = newChild;
+    else if (parent->left == oldChild) parent->left = newChild;
+    else parent->right = newChild;
+    if (newChild) newChild->parent = parent;
+}
+
+static Node *rightRotate(TreeStruct *tree, Node *y) {
     Node *x = y->left;
     Node *T2 = x->right;
+    STATS_INC(STAT_ROTATIONS);
 
+    replaceChild(tree, y->parent, y, x);
     x->right = y;
+    y->parent = x;
     y->left = T2;
+    if (T2) T2->parent = y;
 
-    y->height = max(height(y->left), height(y->right)) + 1;
-    x->height = max(height(x->left), height(x->right)) + 1;
+    updateHeight(y);
+    updateHeight(x);
 
     return x;
 }
 
-static Node *leftRotate(Node *x) {
+static Node *leftRotate(TreeStruct *tree, Node *x) {
     Node *y = x->right;
     Node *T2 = y->left;
+    STATS_INC(STAT_ROTATIONS);
 
+    replaceChild(tree, x->parent, x, y);
     y->left = x;
+    x->parent = y;
     x->right = T2;
+    if (T2) T2->parent = x;
 
-    x->height = max(height(x->left), height(x->right)) + 1;
-    y->height = max(height(y->left), height(y->right)) + 1;
+    updateHeight(x);
+    updateHeight(y);
 
     return y;
 }
@@ -64,81 +119,96 @@ static int getBalance(Node *n) {
     return height(n->left) - height(n->right);
 }
 
+// Sobe de n até a raiz corrigindo alturas e aplicando rotações
+static void rebalance(TreeStruct *tree, Node *n) {
+    while (n != NULL) {
+        updateHeight(n);
+        int balance = getBalance(n);
+
+        if (balance > 1) {
+            if (getBalance(n->left) < 0) leftRotate(tree, n->left);
+            n = rightRotate(tree, n);
+        } else if (balance < -1) {
+            if (getBalance(n->right) > 0) rightRotate(tree, n->right);
+            n = leftRotate(tree, n);
+        }
+        n = n->parent;
+    }
+}
+
 Tree treeInit(TreeCmp cmp) {
-    TreeStruct *tree = (TreeStruct *)malloc(sizeof(TreeStruct));
+    TreeStruct *tree = (TreeStruct *)TED_MALLOC(sizeof(TreeStruct));
     if (tree != NULL) {
         tree->root = NULL;
+        tree->min = NULL;
         tree->compare = cmp;
+        tree->freeNodes = NULL;
+        tree->blocks = NULL;
     }
     return (Tree)tree;
 }
 
-static void freeNodeRecursive(Node *n, TreeFreeData freeData) {
+static void freeDataRecursive(Node *n, TreeFreeData freeData) {
     if (n == NULL) return;
-    freeNodeRecursive(n->left, freeData);
-    freeNodeRecursive(n->right, freeData);
-    
-    if (freeData) {
-        freeData(n->data);
-    }
-    free(n);
+    freeDataRecursive(n->left, freeData);
+    freeDataRecursive(n->right, freeData);
+    freeData(n->data);
 }
 
 void treeFree(Tree t, TreeFreeData freeData) {
     TreeStruct *tree = (TreeStruct *)t;
     if (tree == NULL) return;
-    freeNodeRecursive(tree->root, freeData);
-    free(tree);
-}
+    if (freeData) freeDataRecursive(tree->root, freeData);
 
-static Node *insertRecursive(Node *node, void *data, TreeCmp cmp, bool *success) {
-    if (node == NULL) {
-        *success = true;
-        return newNode(data);
+    NodeBlock *block = tree->blocks;
+    while (block != NULL) {
+        NodeBlock *next = block->next;
+        TED_FREE(block);
+        block = next;
     }
+    TED_FREE(tree);
+}
 
-    int comparison = cmp(data, node->data);
+TreeNode treeInsertNode(Tree t, void *data) {
+    TreeStruct *tree = (TreeStruct *)t;
+    if (tree == NULL) return NULL;
 
-    if (comparison < 0)
-        node->left = insertRecursive(node->left, data, cmp, success);
-    else if (comparison > 0)
-        node->right = insertRecursive(node->right, data, cmp, success);
-    else {
-        // Chaves iguais não permitidas ou ignoradas
-        *success = false; 
-        return node;
+    Node *parent = NULL;
+    Node *current = tree->root;
+    int comparison = 0;
+    bool onlyLeft = true;
+
+    while (current != NULL) {
+        comparison = tree->compare(data, current->data);
+        STATS_INC(STAT_TREE_CMP);
+        parent = current;
+        if (comparison < 0) {
+            current = current->left;
+        } else if (comparison > 0) {
+            current = current->right;
+            onlyLeft = false;
+        } else {
+            // Chaves iguais não permitidas ou ignoradas
+            return NULL;
+        }
     }
 
-    node->height = 1 + max(height(node->left), height(node->right));
-    int balance = getBalance(node);
-
-    // Balanceamento
-    if (balance > 1 && cmp(data, node->left->data) < 0)
-        return rightRotate(node);
+    Node *node = newNode(tree, data);
+    if (!node) return NULL;
 
-    if (balance < -1 && cmp(data, node->right->data) > 0)
-        return leftRotate(node);
+    node->parent = parent;
+    if (parent == NULL) tree->root = node;
+    else if (comparison < 0) parent->left = node;
+    else parent->right = node;
 
-    if (balance > 1 && cmp(data, node->left->data) > 0) {
-        node->left = leftRotate(node->left);
-        return rightRotate(node);
-    }
+    if (onlyLeft) tree->min = node;
 
-    if (balance < -1 && cmp(data, node->right->data) < 0) {
-        node->right = rightRotate(node->right);
-        return leftRotate(node);
-    }
-
-    return node;
+    rebalance(tree, parent);
+    return (TreeNode)node;
 }
 
 bool treeInsert(Tree t, void *data) {
-    TreeStruct *tree = (TreeStruct *)t;
-    if (tree == NULL) return false;
-    
-    bool success = false;
-    tree->root = insertRecursive(tree->root, data, tree->compare, &success);
-    return success;
+    return treeInsertNode(t, data) != NULL;
 }
 
 static Node *minValueNode(Node *node) {
@@ -148,75 +218,70 @@ static Node *minValueNode(Node *node) {
     return current;
 }
 
-static Node *removeRecursive(Node *root, void *data, TreeCmp cmp, void **removedData) {
-    if (root == NULL) return root;
-
-    int comparison = cmp(data, root->data);
-
-    if (comparison < 0)
-        root->left = removeRecursive(root->left, data, cmp, removedData);
-    else if (comparison > 0)
-        root->right = removeRecursive(root->right, data, cmp, removedData);
-    else {
-        if (removedData) *removedData = root->data;
-
-        if ((root->left == NULL) || (root->right == NULL)) {
-            Node *temp = root->left ? root->left : root->right;
-            if (temp == NULL) {
-                temp = root;
-                root = NULL;
-            } else {
-                *root = *temp;
-            }
-            free(temp);
-        } else {
-            Node *temp = minValueNode(root->right);
-            root->data = temp->data;
-            root->right = removeRecursive(root->right, temp->data, cmp, NULL);
-        }
-    }
-
-    if (root == NULL) return root;
-
-    root->height = 1 + max(height(root->left), height(root->right));
-    int balance = getBalance(root);
+void *treeRemoveNode(Tree t, TreeNode n) {
+    TreeStruct *tree = (TreeStruct *)t;
+    Node *z = (Node *)n;
+    if (tree == NULL || z == NULL) return NULL;
 
-    if (balance > 1 && getBalance(root->left) >= 0)
-        return rightRotate(root);
+    void *removedData = z->data;
 
-    if (balance > 1 && getBalance(root->left) < 0) {
-        root->left = leftRotate(root->left);
-        return rightRotate(root);
+    // O menor não tem filho à esquerda: o sucessor é o menor da subárvore
+    // direita ou, na falta dela, o pai
+    if (tree->min == z) {
+        tree->min = z->right ? minValueNode(z->right) : z->parent;
     }
 
-    if (balance < -1 && getBalance(root->right) <= 0)
-        return leftRotate(root);
-
-    if (balance < -1 && getBalance(root->right) > 0) {
-        root->right = rightRotate(root->right);
-        return leftRotate(root);
+    Node *start;
+    if (z->left == NULL || z->right == NULL) {
+        Node *child = z->left ? z->left : z->right;
+        start = z->parent;
+        replaceChild(tree, z->parent, z, child);
+    } else {
+        // Religa o sucessor no lugar de z (sem copiar dados, para que os
+        // handles dos outros nós continuem válidos)
+        Node *y = minValueNode(z->right);
+        if (y->parent != z) {
+            start = y->parent;
+            replaceChild(tree, y->parent, y, y->right);
+            y->right = z->right;
+            y->right->parent = y;
+        } else {
+            start = y;
+        }
+        replaceChild(tree, z->parent, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->height = z->height;
     }
 
-    return root;
+    releaseNode(tree, z);
+    rebalance(tree, start);
+    return removedData;
 }
 
-void *treeRemove(Tree t, void *data) {
-    TreeStruct *tree = (TreeStruct *)t;
-    if (tree == NULL || tree->root == NULL) return NULL;
-
-    void *removedData = NULL;
-    tree->root = removeRecursive(tree->root, data, tree->compare, &removedData);
-    return removedData;
+void *treeNodeData(TreeNode n) {
+    if (n == NULL) return NULL;
+    return ((Node *)n)->data;
 }
 
 static Node *searchRecursive(Node *root, void *data, TreeCmp cmp) {
     if (root == NULL) return NULL;
     int comparison = cmp(data, root->data);
+    STATS_INC(STAT_TREE_CMP);
     if (comparison == 0) return root;
     if (comparison < 0) return searchRecursive(root->left, data, cmp);
     return searchRecursive(root->right, data, cmp);
 }
 
+void *treeRemove(Tree t, void *data) {
+    TreeStruct *tree = (TreeStruct *)t;
+    if (tree == NULL || tree->root == NULL) return NULL;
+
+    Node *found = searchRecursive(tree->root, data, tree->compare);
+    if (found == NULL) return NULL;
+    return treeRemoveNode(t, found);
+}
+
 void *treeSearch(Tree t, void *data) {
     TreeStruct *tree = (TreeStruct *)t;
     if (tree == NULL) return NULL;
@@ -226,12 +291,8 @@ void *treeSearch(Tree t, void *data) {
 
 void *treeMin(Tree t) {
     TreeStruct *tree = (TreeStruct *)t;
-    if (tree == NULL || tree->root == NULL) return NULL;
-    Node *current = tree->root;
-    while (current->left != NULL) {
-        current = current->left;
-    }
-    return current->data;
+    if (tree == NULL || tree->min == NULL) return NULL;
+    return tree->min->data;
 }
 
 void *treeMax(Tree t) {
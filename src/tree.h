@@ -9,6 +9,13 @@
  */
 typedef void *Tree;
 
+/**
+ * @brief Handle opaco para um nó da árvore.
+ * Permanece válido enquanto o elemento estiver na árvore, mesmo após
+ * rotações e remoções de outros elementos.
+ */
+typedef void *TreeNode;
+
 /**
  * @brief Ponteiro de função para comparação de dois elementos.
  * Deve retornar:
@@ -50,6 +57,32 @@ void treeFree(Tree t, TreeFreeData freeData);
  */
 bool treeInsert(Tree t, void *data);
 
+/**
+ * @brief Insere um novo elemento e retorna o handle do nó criado.
+ * O handle permite remover o elemento depois com treeRemoveNode, sem
+ * nenhuma chamada à função de comparação.
+ * @param t A árvore.
+ * @param data O ponteiro para o dado a armazenar.
+ * @return O handle do nó, ou NULL se a chave já existir ou falhar a alocação.
+ */
+TreeNode treeInsertNode(Tree t, void *data);
+
+/**
+ * @brief Remove o nó indicado pelo handle em O(log n), apenas rebalanceando.
+ * O handle deixa de ser válido após a chamada.
+ * @param t A árvore.
+ * @param n O handle devolvido por treeInsertNode.
+ * @return O ponteiro para o dado removido, ou NULL se t ou n forem NULL.
+ */
+void *treeRemoveNode(Tree t, TreeNode n);
+
+/**
+ * @brief Obtém o dado armazenado num nó.
+ * @param n O handle do nó.
+ * @return O ponteiro para o dado, ou NULL se n for NULL.
+ */
+void *treeNodeData(TreeNode n);
+
 /**
  * @brief Remove um elemento específico da árvore.
  * A busca pelo elemento a remover é feita usando a função de comparação.
@@ -68,7 +101,7 @@ void *treeRemove(Tree t, void *data);
 void *treeSearch(Tree t, void *data);
 
 /**
- * @brief Retorna o MENOR elemento da árvore.
+ * @brief Retorna o MENOR elemento da árvore em O(1) (mantido em cache).
  * @param t A árvore.
  * @return O ponteiro para o menor dado, ou NULL se a árvore estiver vazia.
  */
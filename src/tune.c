@@ -0,0 +1,210 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "tune.h"
+#include "figure.h"
+#include "svgwriter.h"
+#include "vis.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Repetições de cada combinação (conta a melhor) e observadores por lado da
+// grelha em que são medidas
+#define TUNE_RUNS 3
+#define TUNE_GRID 2
+// Entradas guardadas na cache
+#define TUNE_MAX_ENTRIES 128
+
+typedef struct {
+  char sortType;
+  int threshold;
+} TuneCandidate;
+
+// Limiares experimentados no merge sort; o qsort ignora o limiar e fica com
+// o valor por omissão
+static const int g_thresholds[] = {1, 8, 16, 32, 64};
+#define TUNE_THRESHOLDS (int)(sizeof(g_thresholds) / sizeof(g_thresholds[0]))
+#define TUNE_MAX_CANDIDATES (TUNE_THRESHOLDS + 1)
+#define TUNE_DEFAULT_THRESHOLD 10
+
+// A restrição (o que foi fixado na linha de comando) faz parte da chave: um
+// resultado restrito nunca serve uma procura livre, nem o contrário
+typedef struct {
+  int bucket;
+  char fixedSort;
+  int fixedThreshold;
+  char sortType;
+  int threshold;
+  char cpu[128];
+} TuneEntry;
+
+static double nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+// "model name" de /proc/cpuinfo, ou "desconhecido"
+static void cpuModel(char *dest, size_t size) {
+  snprintf(dest, size, "desconhecido");
+  FILE *f = fopen("/proc/cpuinfo", "r");
+  if (!f)
+    return;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "model name", 10) != 0)
+      continue;
+    char *colon = strchr(line, ':');
+    if (colon) {
+      colon++;
+      while (*colon == ' ' || *colon == '\t')
+        colon++;
+      colon[strcspn(colon, "\r\n")] = '\0';
+      snprintf(dest, size, "%s", colon);
+    }
+    break;
+  }
+  fclose(f);
+}
+
+// Ordem de grandeza (base 2) do número de figuras
+static int sizeBucket(int figures) {
+  int bucket = 0;
+  while (figures > 1) {
+    figures >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+// Linhas "grupo restrição ordenação limiar modelo do CPU", com a restrição
+// escrita "to:in" ('*' e 0 quando livres); as que não se leem são descartadas
+static int loadCache(const char *path, TuneEntry *entries) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return 0;
+  int count = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f) && count < TUNE_MAX_ENTRIES) {
+    TuneEntry *e = &entries[count];
+    int used = 0;
+    if (line[0] == '#' ||
+        sscanf(line, "%d %c:%d %c %d %n", &e->bucket, &e->fixedSort, &e->fixedThreshold,
+               &e->sortType, &e->threshold, &used) != 5)
+      continue;
+    line[strcspn(line, "\r\n")] = '\0';
+    snprintf(e->cpu, sizeof(e->cpu), "%s", line + used);
+    if (e->threshold > 0)
+      count++;
+  }
+  fclose(f);
+  return count;
+}
+
+static bool saveCache(const char *path, const TuneEntry *entries, int count) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  fprintf(f, "# grupo (log2 das figuras) restrição (-to:-in) ordenação limiar modelo do CPU\n");
+  for (int i = 0; i < count; i++)
+    fprintf(f, "%d %c:%d %c %d %s\n", entries[i].bucket, entries[i].fixedSort,
+            entries[i].fixedThreshold, entries[i].sortType, entries[i].threshold,
+            entries[i].cpu);
+  return fclose(f) == 0;
+}
+
+// Combinações compatíveis com o que foi fixado (0 quando livre)
+static int buildCandidates(char fixedSort, int fixedThreshold, TuneCandidate *out) {
+  int count = 0;
+  if (fixedSort != 'm') {
+    out[count].sortType = fixedSort ? fixedSort : 'q';
+    out[count].threshold = fixedThreshold ? fixedThreshold : TUNE_DEFAULT_THRESHOLD;
+    count++;
+  }
+  if (fixedSort == 0 || fixedSort == 'm') {
+    if (fixedThreshold) {
+      out[count++] = (TuneCandidate){'m', fixedThreshold};
+    } else {
+      for (int t = 0; t < TUNE_THRESHOLDS; t++)
+        out[count++] = (TuneCandidate){'m', g_thresholds[t]};
+    }
+  }
+  return count;
+}
+
+// Mede todas as combinações, intercaladas em cada repetição para que uma
+// variação do relógio da máquina não favoreça nenhuma
+static TuneCandidate calibrate(List figures, FigureBounds bounds, const TuneCandidate *candidates, int count) {
+  // Sem escolha possível (ex.: -to q) não há nada a medir
+  if (count == 1)
+    return candidates[0];
+  double minX = 0, minY = 0, maxX = 0, maxY = 0;
+  figureBoundsGet(bounds, &minX, &minY, &maxX, &maxY);
+
+  SvgWriter w = svgWriterInitMemory();
+  double best[TUNE_MAX_CANDIDATES];
+  for (int r = 0; r < TUNE_RUNS; r++) {
+    for (int c = 0; c < count; c++) {
+      double start = nowMs();
+      for (int gx = 1; gx <= TUNE_GRID; gx++) {
+        for (int gy = 1; gy <= TUNE_GRID; gy++) {
+          double ox = minX + (maxX - minX) * gx / (TUNE_GRID + 1);
+          double oy = minY + (maxY - minY) * gy / (TUNE_GRID + 1);
+          svgWriterReset(w);
+          visDrawRegion(figures, bounds, ox, oy, w, candidates[c].sortType, candidates[c].threshold);
+        }
+      }
+      double ms = nowMs() - start;
+      if (r == 0 || ms < best[c])
+        best[c] = ms;
+    }
+  }
+  svgWriterClose(w);
+
+  int chosen = 0;
+  for (int c = 1; c < count; c++)
+    if (best[c] < best[chosen])
+      chosen = c;
+  return candidates[chosen];
+}
+
+bool tuneChoose(List figures, FigureBounds bounds, const char *cachePath, char fixedSort, int fixedThreshold,
+                char *sortType, int *threshold) {
+  static TuneEntry entries[TUNE_MAX_ENTRIES];
+  char cpu[128];
+  cpuModel(cpu, sizeof(cpu));
+  int bucket = sizeBucket(listGetSize(figures));
+  char keySort = fixedSort ? fixedSort : '*';
+
+  int count = loadCache(cachePath, entries);
+  for (int i = 0; i < count; i++) {
+    if (entries[i].bucket == bucket && entries[i].fixedSort == keySort &&
+        entries[i].fixedThreshold == fixedThreshold && strcmp(entries[i].cpu, cpu) == 0) {
+      *sortType = entries[i].sortType;
+      *threshold = entries[i].threshold;
+      return true;
+    }
+  }
+
+  TuneCandidate candidates[TUNE_MAX_CANDIDATES];
+  int candidateCount = buildCandidates(fixedSort, fixedThreshold, candidates);
+  TuneCandidate chosen = calibrate(figures, bounds, candidates, candidateCount);
+  *sortType = chosen.sortType;
+  *threshold = chosen.threshold;
+
+  // Cache cheia: descarta a entrada mais antiga
+  if (count == TUNE_MAX_ENTRIES) {
+    memmove(entries, entries + 1, (count - 1) * sizeof(TuneEntry));
+    count--;
+  }
+  TuneEntry *e = &entries[count++];
+  e->bucket = bucket;
+  e->fixedSort = keySort;
+  e->fixedThreshold = fixedThreshold;
+  e->sortType = chosen.sortType;
+  e->threshold = chosen.threshold;
+  snprintf(e->cpu, sizeof(e->cpu), "%s", cpu);
+  if (!saveCache(cachePath, entries, count))
+    fprintf(stderr, "AVISO: Não foi possível gravar a cache de calibração em %s\n", cachePath);
+  return false;
+}
@@ -0,0 +1,28 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "figure.h"
+#include "list.h"
+#include <stdbool.h>
+
+/**
+ * @brief Escolhe a ordenação dos eventos da varredura (-to) e o limiar da
+ * inserção (-in) para a cena carregada. Procura primeiro no ficheiro de
+ * cache uma escolha para o mesmo modelo de CPU, a mesma ordem de grandeza
+ * do número de figuras e a mesma restrição. Se não houver, mede visDrawRegion
+ * com cada combinação candidata compatível com a restrição em alguns
+ * observadores espalhados pela cena, fica com a mais rápida e grava-a na
+ * cache.
+ * @param figures Cena já lida do .geo.
+ * @param bounds Caixa envolvente da cena, onde ficam os observadores.
+ * @param cachePath Ficheiro da cache (criado se não existir).
+ * @param fixedSort Ordenação fixada pelo utilizador, ou 0 se livre.
+ * @param fixedThreshold Limiar fixado pelo utilizador, ou 0 se livre.
+ * @param sortType Recebe a ordenação ('q' ou 'm', ou fixedSort).
+ * @param threshold Recebe o limiar (ou fixedThreshold).
+ * @return true se a escolha veio da cache, false se foi medida agora.
+ */
+bool tuneChoose(List figures, FigureBounds bounds, const char *cachePath, char fixedSort, int fixedThreshold,
+                char *sortType, int *threshold);
+
+#endif // TUNE_H
@@ -4,6 +4,10 @@
 #include "list.h"
 #include "svg.h"
 #include "geom.h"
+#include "heatmap.h"
+#include "stats.h"
+#include "trace.h"
+#include "probes.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -14,6 +18,20 @@
 // --- Configurações ---
 #define VIS_INF 1.0e15 
 #define VIS_TOLERANCE 0.000001
+// Erro angular máximo (radianos, visto do observador) ao desenhar arcos
+#define VIS_ARC_ERROR 0.002
+#define VIS_ARC_MIN_SAGITTA 0.05
+#define VIS_ARC_MAX_STEPS 64
+// Distância mínima entre vértices consecutivos do polígono
+#define VIS_MIN_VERTEX_GAP 0.01
+// Desvio máximo para um vértice ser considerado sobre a reta dos vizinhos
+#define VIS_COLLINEAR_EPS 1.0e-6
+// Avanço angular com que se desempatam segmentos à mesma distância
+#define VIS_TIE_ANGLE 1.0e-5
+// Folga para um ponto de cruzamento estar sobre o trecho usado de um arco
+#define VIS_CROSS_EPS 1.0e-6
+// Maior polígono fechado tratado por addClosedPolygon
+#define VIS_MAX_POLYGON 8
 
 #ifndef VIS_PI
 #define VIS_PI 3.14159265358979323846
@@ -27,24 +45,69 @@ typedef struct {
     double x, y;
 } Vertex;
 
+// Tipos de segmento: reta, ou arco de círculo (p1 = centro) do qual se usa a
+// interseção mais próxima (observador fora) ou a mais distante (dentro)
+#define SEG_LINE 0
+#define SEG_ARC 1
+#define SEG_ARC_INNER 2
+
 typedef struct {
     Vertex p1, p2;
+    int kind;
+    double radius;
     int originalId;
     double angleStart; 
     double angleEnd;
+    bool startShared; // início tratado por um evento de vértice (TYPE_SWAP)
+    bool endShared;   // fim tratado por um evento de vértice (TYPE_SWAP)
+    TreeNode node; // handle na árvore de segmentos ativos (NULL se inativo)
 } Segment;
 
-#define TYPE_START 0
-#define TYPE_END 1
+// Extremidade de um segmento que coincide com um vértice de polígono
+typedef struct {
+    Segment *seg;
+    bool isStart;
+} SegEnd;
+
+// Vértice de polígono onde uma aresta sai da varredura e a seguinte entra
+typedef struct {
+    double angle;
+    Segment *out;
+    Segment *in;
+} VertexSwap;
+
+// A ordem dos valores define a prioridade dentro de um mesmo ângulo
+#define TYPE_END 0
+#define TYPE_CROSS 1
+#define TYPE_SWAP 2
+#define TYPE_START 3
 
 typedef struct {
     double angle;
     int type;
     Segment *seg;
+    Segment *next; // aresta que entra num TYPE_SWAP; o outro segmento num TYPE_CROSS
 } Event;
 
+// Vértice do polígono de visibilidade e o segmento onde o raio bateu
+typedef struct {
+    double x, y;
+    const Segment *seg;
+} RegionPoint;
+
+// Vértices acumulados antes da formatação, para poderem ser simplificados
+typedef struct {
+    RegionPoint *pts;
+    int count;
+    int capacity;
+} Region;
+
 static double g_ox, g_oy;
 static double g_currentAngle;
+// Tolerância de Douglas-Peucker (0 = só junta vértices colineares)
+static double g_simplifyTolerance = 0.0;
+// Caixa do último polígono desenhado
+static double g_regionMinX, g_regionMinY, g_regionMaxX, g_regionMaxY;
 
 // --- Geometria ---
 
@@ -54,8 +117,24 @@ static double getAngle(double x, double y) {
     return a;
 }
 
+// Distância até o círculo ao longo do raio. Só é chamada dentro do intervalo
+// angular do arco, onde o discriminante só fica negativo por arredondamento
+// junto às tangentes.
+static double getRayArcDist(Segment *s, double angle) {
+    if (angle < s->angleStart - VIS_TOLERANCE || angle > s->angleEnd + VIS_TOLERANCE) return VIS_INF;
+    double cx = s->p1.x - g_ox, cy = s->p1.y - g_oy;
+    double b = cos(angle) * cx + sin(angle) * cy;
+    double disc = b * b - (cx * cx + cy * cy - s->radius * s->radius);
+    if (disc < 0) disc = 0;
+    double d = (s->kind == SEG_ARC_INNER) ? b + sqrt(disc) : b - sqrt(disc);
+    if (d < 0) return VIS_INF;
+    return d;
+}
+
 static double getRaySegDist(Segment *s, double angle) {
     if (!s) return VIS_INF;
+    STATS_INC(STAT_INTERSECTIONS);
+    if (s->kind != SEG_LINE) return getRayArcDist(s, angle);
     double d = geomRaySegmentIntersect(g_ox, g_oy, angle, 
                                        s->p1.x, s->p1.y, 
                                        s->p2.x, s->p2.y);
@@ -77,6 +156,12 @@ int visTreeCompare(const void *a, const void *b) {
     if (fabs(d1 - d2) > 0.001) {
         return (d1 < d2) ? -1 : 1;
     }
+    // Mesma distância (vértice ou cruzamento comum): vale a ordem logo a seguir
+    double n1 = getRaySegDist(s1, g_currentAngle + VIS_TIE_ANGLE);
+    double n2 = getRaySegDist(s2, g_currentAngle + VIS_TIE_ANGLE);
+    if (n1 != n2) {
+        return (n1 < n2) ? -1 : 1;
+    }
     // Desempate por ID para estabilidade
     if (s1->originalId != s2->originalId) {
         return (s1->originalId < s2->originalId) ? -1 : 1;
@@ -88,13 +173,14 @@ int visTreeCompare(const void *a, const void *b) {
 int visEventCompare(const void *a, const void *b) {
     Event *e1 = (Event *)a;
     Event *e2 = (Event *)b;
+    STATS_INC(STAT_EVENT_CMP);
 
     if (e1->angle < e2->angle - VIS_TOLERANCE) return -1;
     if (e1->angle > e2->angle + VIS_TOLERANCE) return 1;
 
     // Prioriza END para limpar obstáculos antigos antes de inserir novos
     if (e1->type != e2->type) {
-        return (e1->type == TYPE_END) ? -1 : 1;
+        return (e1->type < e2->type) ? -1 : 1;
     }
     return 0;
 }
@@ -117,8 +203,8 @@ static void merge(Event *arr, int l, int m, int r) {
     int i, j, k;
     int n1 = m - l + 1;
     int n2 = r - m;
-    Event *L = malloc(n1 * sizeof(Event));
-    Event *R = malloc(n2 * sizeof(Event));
+    Event *L = TED_MALLOC(n1 * sizeof(Event));
+    Event *R = TED_MALLOC(n2 * sizeof(Event));
     for (i = 0; i < n1; i++) L[i] = arr[l + i];
     for (j = 0; j < n2; j++) R[j] = arr[m + 1 + j];
     i = 0; j = 0; k = l;
@@ -128,7 +214,7 @@ static void merge(Event *arr, int l, int m, int r) {
     }
     while (i < n1) arr[k++] = L[i++];
     while (j < n2) arr[k++] = R[j++];
-    free(L); free(R);
+    TED_FREE(L); TED_FREE(R);
 }
 
 static void mergeSortHybrid(Event *arr, int l, int r, int threshold) {
@@ -143,7 +229,7 @@ static void mergeSortHybrid(Event *arr, int l, int r, int threshold) {
     }
 }
 
-// --- Bounding Box Global ---
+// --- Bounding Box da Cena ---
 
 static void updateBounds(double x, double y, double *minX, double *minY, double *maxX, double *maxY) {
     if (x < *minX) *minX = x;
@@ -152,23 +238,13 @@ static void updateBounds(double x, double y, double *minX, double *minY, double
     if (y > *maxY) *maxY = y;
 }
 
-static void calculateSceneBounds(List figures, double ox, double oy, double *x1, double *y1, double *x2, double *y2) {
+// A caixa das figuras vem da cena; aqui só se junta o observador
+static void calculateSceneBounds(FigureBounds bounds, double ox, double oy, double *x1, double *y1, double *x2, double *y2) {
     *x1 = ox; *x2 = ox; *y1 = oy; *y2 = oy;
-    if (!figures) return;
-    int i = 0; void *data;
-    while ((data = listGetPos(figures, i++))) {
-        Figure f = (Figure)data;
-        int shape = getFigureShape(f);
-        if (shape == RECTANGLE) {
-            double x, y, w, h; getFigureXY(&x, &y, f); getRectangleWH(f, &w, &h);
-            updateBounds(x, y, x1, y1, x2, y2); updateBounds(x+w, y+h, x1, y1, x2, y2);
-        } else if (shape == CIRCLE) {
-            double x, y, r; getFigureXY(&x, &y, f); r = getCircleR(f);
-            updateBounds(x-r, y-r, x1, y1, x2, y2); updateBounds(x+r, y+r, x1, y1, x2, y2);
-        } else if (shape == LINE) {
-            double lx1, ly1, lx2, ly2; getLineP(f, &lx1, &ly1, &lx2, &ly2);
-            updateBounds(lx1, ly1, x1, y1, x2, y2); updateBounds(lx2, ly2, x1, y1, x2, y2);
-        }
+    double minX, minY, maxX, maxY;
+    if (figureBoundsGet(bounds, &minX, &minY, &maxX, &maxY)) {
+        updateBounds(minX, minY, x1, y1, x2, y2);
+        updateBounds(maxX, maxY, x1, y1, x2, y2);
     }
     double margin = 20.0;
     *x1 -= margin; *y1 -= margin; *x2 += margin; *y2 += margin;
@@ -176,9 +252,21 @@ static void calculateSceneBounds(List figures, double ox, double oy, double *x1,
 
 // --- Gestão de Segmentos ---
 
-static void addSegment(double x1, double y1, double x2, double y2, List segList, int id) {
-    double a1 = getAngle(x1, y1);
-    double a2 = getAngle(x2, y2);
+static Segment *newSegment(double x1, double y1, double x2, double y2, double angleStart, double angleEnd, int id) {
+    Segment *s = TED_MALLOC(sizeof(Segment));
+    STATS_INC(STAT_SEGMENTS);
+    s->p1.x = x1; s->p1.y = y1; s->p2.x = x2; s->p2.y = y2; s->originalId = id;
+    s->kind = SEG_LINE; s->radius = 0.0;
+    s->angleStart = angleStart; s->angleEnd = angleEnd;
+    s->startShared = false; s->endShared = false; s->node = NULL;
+    return s;
+}
+
+// Adiciona o segmento (x1,y1)-(x2,y2) cujos extremos têm ângulos a1 e a2 já
+// calculados. Se end1/end2 não forem NULL, recebem o pedaço (e qual dos seus
+// limites angulares) que toca cada extremo.
+static void addSegmentAngles(double x1, double y1, double a1, double x2, double y2, double a2,
+                             List segList, int id, SegEnd *end1, SegEnd *end2) {
     double diff = fabs(a1 - a2);
 
     // Divisão no eixo 0 (raio positivo X)
@@ -187,32 +275,151 @@ static void addSegment(double x1, double y1, double x2, double y2, List segList,
             double t = (g_oy - y1) / (y2 - y1);
             double ix = x1 + t * (x2 - x1);
             if (ix >= g_ox) {
-                // Segmento 1
-                Segment *s1 = malloc(sizeof(Segment));
-                s1->p1.x = x1; s1->p1.y = y1; s1->p2.x = ix; s1->p2.y = g_oy; s1->originalId = id;
-                double ang1 = (a1 > a2) ? a1 : a2;
-                s1->angleStart = ang1; s1->angleEnd = 2 * VIS_PI;
-
-                // Segmento 2
-                Segment *s2 = malloc(sizeof(Segment));
-                s2->p1.x = ix; s2->p1.y = g_oy; s2->p2.x = x2; s2->p2.y = y2; s2->originalId = id;
-                double ang2 = (a1 > a2) ? a2 : a1;
-                s2->angleStart = 0.0; s2->angleEnd = ang2;
-
-                listAddLast(segList, s1); listAddLast(segList, s2);
+                // O pedaço [maior ângulo, 2PI] é o que contém o extremo de maior ângulo
+                bool firstHigh = a1 > a2;
+                Segment *sHigh, *sLow;
+                if (firstHigh) {
+                    sHigh = newSegment(x1, y1, ix, g_oy, a1, 2 * VIS_PI, id);
+                    sLow = newSegment(ix, g_oy, x2, y2, 0.0, a2, id);
+                } else {
+                    sHigh = newSegment(ix, g_oy, x2, y2, a2, 2 * VIS_PI, id);
+                    sLow = newSegment(x1, y1, ix, g_oy, 0.0, a1, id);
+                }
+                listAddLast(segList, sHigh); listAddLast(segList, sLow);
+
+                if (end1) { end1->seg = firstHigh ? sHigh : sLow; end1->isStart = firstHigh; }
+                if (end2) { end2->seg = firstHigh ? sLow : sHigh; end2->isStart = !firstHigh; }
                 return;
             }
         }
     }
-    Segment *s = malloc(sizeof(Segment));
-    s->p1.x = x1; s->p1.y = y1; s->p2.x = x2; s->p2.y = y2; s->originalId = id;
-    if (a1 < a2) { s->angleStart = a1; s->angleEnd = a2; }
-    else { s->angleStart = a2; s->angleEnd = a1; }
-    
+    Segment *s;
+    if (a1 < a2) s = newSegment(x1, y1, x2, y2, a1, a2, id);
+    else s = newSegment(x1, y1, x2, y2, a2, a1, id);
     listAddLast(segList, s);
+
+    if (end1) { end1->seg = s; end1->isStart = a1 < a2; }
+    if (end2) { end2->seg = s; end2->isStart = !(a1 < a2); }
+}
+
+static void addSegment(double x1, double y1, double x2, double y2, List segList, int id) {
+    addSegmentAngles(x1, y1, getAngle(x1, y1), x2, y2, getAngle(x2, y2), segList, id, NULL, NULL);
 }
 
-static void parseFigures(List figures, List segList, double minX, double minY, double maxX, double maxY) {
+static bool hasAngularSpan(Segment *s) {
+    return s->angleEnd - s->angleStart >= VIS_TOLERANCE;
+}
+
+// Adiciona as arestas de um polígono fechado e convexo, descartando as que
+// estão de costas para o observador. A ordem dos vértices é a mesma usada
+// pelas chamadas de addSegment (anti-horária no referencial matemático), por
+// isso uma aresta é traseira quando o observador fica à sua esquerda.
+// O ângulo de cada vértice é calculado uma única vez e, se swapList não for
+// NULL, cada vértice comum a duas arestas mantidas gera um único VertexSwap.
+static void addClosedPolygon(const double *xs, const double *ys, int n, List segList, List swapList, int id) {
+    // Polígonos maiores entram como arestas soltas, sem descarte nem VertexSwap
+    if (n > VIS_MAX_POLYGON) {
+        for (int k = 0; k < n; k++) {
+            int next = (k + 1) % n;
+            addSegment(xs[k], ys[k], xs[next], ys[next], segList, id);
+        }
+        return;
+    }
+    double area = 0.0;
+    for (int k = 0; k < n; k++) {
+        int next = (k + 1) % n;
+        area += xs[k] * ys[next] - xs[next] * ys[k];
+    }
+    double winding = (area < 0) ? -1.0 : 1.0;
+
+    bool back[VIS_MAX_POLYGON];
+    bool inside = true;
+    for (int k = 0; k < n; k++) {
+        int next = (k + 1) % n;
+        double cross = winding * geomCrossProduct(xs[k], ys[k], xs[next], ys[next], g_ox, g_oy);
+        back[k] = cross > 0;
+        if (!back[k]) inside = false;
+    }
+
+    // Com o observador dentro da figura todas as arestas são visíveis
+    bool kept[VIS_MAX_POLYGON];
+    bool used[VIS_MAX_POLYGON] = { false };
+    for (int k = 0; k < n; k++) {
+        kept[k] = !back[k] || inside;
+        if (kept[k]) { used[k] = true; used[(k + 1) % n] = true; }
+    }
+
+    double ang[VIS_MAX_POLYGON];
+    for (int k = 0; k < n; k++) {
+        if (used[k]) ang[k] = getAngle(xs[k], ys[k]);
+    }
+
+    // head[k]: extremo da aresta k no vértice k; tail[k]: no vértice k+1
+    SegEnd head[VIS_MAX_POLYGON], tail[VIS_MAX_POLYGON];
+    for (int k = 0; k < n; k++) {
+        if (!kept[k]) continue;
+        int next = (k + 1) % n;
+        addSegmentAngles(xs[k], ys[k], ang[k], xs[next], ys[next], ang[next], segList, id, &head[k], &tail[k]);
+    }
+
+    if (!swapList) return;
+    for (int v = 0; v < n; v++) {
+        int prev = (v + n - 1) % n;
+        if (!kept[prev] || !kept[v]) continue;
+        SegEnd a = tail[prev], b = head[v];
+        if (a.isStart == b.isStart) continue;
+
+        Segment *out = a.isStart ? b.seg : a.seg;
+        Segment *in = a.isStart ? a.seg : b.seg;
+        // Arestas sem abertura angular ficam com os eventos próprios
+        if (!hasAngularSpan(out) || !hasAngularSpan(in)) continue;
+
+        VertexSwap *sw = TED_MALLOC(sizeof(VertexSwap));
+        sw->angle = ang[v];
+        sw->out = out;
+        sw->in = in;
+        out->endShared = true;
+        in->startShared = true;
+        listAddLast(swapList, sw);
+    }
+}
+
+// Adiciona um círculo como arco entre as duas tangentes vistas do observador
+// (dois eventos), ou como arco interno de volta completa se o observador
+// estiver dentro dele.
+static void addCircle(double cx, double cy, double r, List segList, int id) {
+    if (r < VIS_TOLERANCE) return;
+    double dist = geomDist(cx, cy, g_ox, g_oy);
+
+    if (dist <= r) {
+        Segment *s = newSegment(cx, cy, cx, cy, 0.0, 2 * VIS_PI, id);
+        s->kind = SEG_ARC_INNER; s->radius = r;
+        listAddLast(segList, s);
+        return;
+    }
+
+    double center = getAngle(cx, cy);
+    double half = asin(r / dist);
+    double a1 = center - half, a2 = center + half;
+
+    // Divisão no eixo 0: o arco é o mesmo círculo, só o intervalo muda
+    if (a1 < 0 || a2 > 2 * VIS_PI) {
+        if (a1 < 0) a1 += 2 * VIS_PI;
+        if (a2 > 2 * VIS_PI) a2 -= 2 * VIS_PI;
+        Segment *sHigh = newSegment(cx, cy, cx, cy, a1, 2 * VIS_PI, id);
+        Segment *sLow = newSegment(cx, cy, cx, cy, 0.0, a2, id);
+        sHigh->kind = SEG_ARC; sHigh->radius = r;
+        sLow->kind = SEG_ARC; sLow->radius = r;
+        listAddLast(segList, sHigh); listAddLast(segList, sLow);
+        return;
+    }
+
+    Segment *s = newSegment(cx, cy, cx, cy, a1, a2, id);
+    s->kind = SEG_ARC; s->radius = r;
+    listAddLast(segList, s);
+}
+
+static void parseFigures(List figures, List segList, List swapList, double minX, double minY, double maxX, double maxY) {
     // Adiciona o Mundo (Bounding Box)
     // Importante: A ordem dos vértices deve ser consistente
     addSegment(maxX, minY, maxX, maxY, segList, -1); // Direita
@@ -228,35 +435,327 @@ static void parseFigures(List figures, List segList, double minX, double minY, d
         int id = getFigureId(fig);
         if (shape == RECTANGLE) {
             double x, y, w, h; getFigureXY(&x, &y, fig); getRectangleWH(fig, &w, &h);
-            addSegment(x, y, x+w, y, segList, id); addSegment(x+w, y, x+w, y+h, segList, id);
-            addSegment(x+w, y+h, x, y+h, segList, id); addSegment(x, y+h, x, y, segList, id);
+            double xs[4] = { x, x+w, x+w, x }, ys[4] = { y, y, y+h, y+h };
+            addClosedPolygon(xs, ys, 4, segList, swapList, id);
         } else if (shape == LINE) {
             double x1, y1, x2, y2; getLineP(fig, &x1, &y1, &x2, &y2);
             addSegment(x1, y1, x2, y2, segList, id);
         } else if (shape == CIRCLE) {
             double cx, cy, r; getFigureXY(&cx, &cy, fig); r = getCircleR(fig);
-            double x0 = cx-r, y0 = cy-r, dim = 2*r;
-            addSegment(x0, y0, x0+dim, y0, segList, id); addSegment(x0+dim, y0, x0+dim, y0+dim, segList, id);
-            addSegment(x0+dim, y0+dim, x0, y0+dim, segList, id); addSegment(x0, y0+dim, x0, y0, segList, id);
+            addCircle(cx, cy, r, segList, id);
+        }
+    }
+}
+
+// --- Cruzamentos ---
+
+// A árvore só é reordenada nos eventos. Onde dois obstáculos de figuras
+// diferentes se cruzam, a ordem por distância troca entre eventos, por isso
+// cada cruzamento vira um evento TYPE_CROSS que reinsere um dos segmentos.
+
+typedef struct {
+    double minX, minY, maxX, maxY;
+    Segment *seg;
+} SegBox;
+
+typedef struct {
+    Event *items;
+    int count;
+    int capacity;
+} EventBuffer;
+
+static int compareBoxMinX(const void *a, const void *b) {
+    double x1 = ((const SegBox *)a)->minX, x2 = ((const SegBox *)b)->minX;
+    return (x1 > x2) - (x1 < x2);
+}
+
+static void segmentBox(Segment *s, SegBox *b) {
+    b->seg = s;
+    if (s->kind == SEG_LINE) {
+        b->minX = fmin(s->p1.x, s->p2.x); b->maxX = fmax(s->p1.x, s->p2.x);
+        b->minY = fmin(s->p1.y, s->p2.y); b->maxY = fmax(s->p1.y, s->p2.y);
+    } else {
+        b->minX = s->p1.x - s->radius; b->maxX = s->p1.x + s->radius;
+        b->minY = s->p1.y - s->radius; b->maxY = s->p1.y + s->radius;
+    }
+}
+
+// O ponto da circunferência de s está no trecho que s representa: dentro do
+// intervalo angular e no ramo (mais próximo ou mais distante) que s usa
+static bool onArcBranch(Segment *s, double x, double y) {
+    double a = getAngle(x, y);
+    if (a < s->angleStart - VIS_TOLERANCE || a > s->angleEnd + VIS_TOLERANCE) return false;
+    double d = getRayArcDist(s, a);
+    return fabs(d - geomDist(x, y, g_ox, g_oy)) <= VIS_CROSS_EPS * (1.0 + d);
+}
+
+// Pontos em que a e b se cruzam (no máximo dois); extremos não contam
+static int segmentCrossings(Segment *a, Segment *b, double *xs, double *ys) {
+    if (a->kind != SEG_LINE && b->kind == SEG_LINE) { Segment *t = a; a = b; b = t; }
+    int n = 0;
+    double ex = a->p2.x - a->p1.x, ey = a->p2.y - a->p1.y;
+    if (a->kind == SEG_LINE && b->kind == SEG_LINE) {
+        double fx = b->p2.x - b->p1.x, fy = b->p2.y - b->p1.y;
+        double den = ex * fy - ey * fx;
+        if (fabs(den) < VIS_TOLERANCE) return 0;
+        double wx = b->p1.x - a->p1.x, wy = b->p1.y - a->p1.y;
+        double t = (wx * fy - wy * fx) / den;
+        double u = (wx * ey - wy * ex) / den;
+        if (t <= VIS_TOLERANCE || t >= 1 - VIS_TOLERANCE || u <= VIS_TOLERANCE || u >= 1 - VIS_TOLERANCE) return 0;
+        xs[0] = a->p1.x + t * ex; ys[0] = a->p1.y + t * ey;
+        return 1;
+    }
+    if (a->kind == SEG_LINE) {
+        // |p1 + t*e - c|^2 = r^2
+        double wx = a->p1.x - b->p1.x, wy = a->p1.y - b->p1.y;
+        double qa = ex * ex + ey * ey;
+        double qb = 2 * (ex * wx + ey * wy);
+        double qc = wx * wx + wy * wy - b->radius * b->radius;
+        double disc = qb * qb - 4 * qa * qc;
+        if (qa < VIS_TOLERANCE || disc <= 0) return 0;
+        for (int k = -1; k <= 1; k += 2) {
+            double t = (-qb + k * sqrt(disc)) / (2 * qa);
+            if (t <= VIS_TOLERANCE || t >= 1 - VIS_TOLERANCE) continue;
+            double x = a->p1.x + t * ex, y = a->p1.y + t * ey;
+            if (onArcBranch(b, x, y)) { xs[n] = x; ys[n] = y; n++; }
         }
+        return n;
+    }
+    double dx = b->p1.x - a->p1.x, dy = b->p1.y - a->p1.y;
+    double d = sqrt(dx * dx + dy * dy);
+    if (d < VIS_TOLERANCE || d >= a->radius + b->radius || d <= fabs(a->radius - b->radius)) return 0;
+    double along = (a->radius * a->radius - b->radius * b->radius + d * d) / (2 * d);
+    double h = sqrt(fmax(0.0, a->radius * a->radius - along * along));
+    double mx = a->p1.x + along * dx / d, my = a->p1.y + along * dy / d;
+    for (int k = -1; k <= 1; k += 2) {
+        double x = mx - k * h * dy / d, y = my + k * h * dx / d;
+        if (onArcBranch(a, x, y) && onArcBranch(b, x, y)) { xs[n] = x; ys[n] = y; n++; }
+    }
+    return n;
+}
+
+static void eventBufferAdd(EventBuffer *buf, double angle, Segment *a, Segment *b) {
+    if (buf->count == buf->capacity) {
+        int capacity = buf->capacity ? buf->capacity * 2 : 64;
+        Event *items = TED_REALLOC(buf->items, sizeof(Event) * capacity);
+        if (!items) return;
+        buf->items = items;
+        buf->capacity = capacity;
+    }
+    Event *e = &buf->items[buf->count++];
+    e->angle = angle;
+    e->type = TYPE_CROSS;
+    e->seg = a;
+    e->next = b;
+}
+
+// Procura os cruzamentos entre segmentos de figuras diferentes, varrendo as
+// caixas por x para só testar pares que se podem tocar
+static void findCrossings(Segment **segs, int numSegs, EventBuffer *out) {
+    SegBox *boxes = TED_MALLOC(sizeof(SegBox) * (numSegs > 0 ? numSegs : 1));
+    if (!boxes) return;
+    int n = 0;
+    for (int k = 0; k < numSegs; k++) {
+        // As paredes do mundo envolvem a cena e não cruzam nada
+        if (segs[k]->originalId < 0 || !hasAngularSpan(segs[k])) continue;
+        segmentBox(segs[k], &boxes[n++]);
+    }
+    qsort(boxes, n, sizeof(SegBox), compareBoxMinX);
+
+    double xs[2], ys[2];
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n && boxes[j].minX <= boxes[i].maxX; j++) {
+            if (boxes[j].minY > boxes[i].maxY || boxes[j].maxY < boxes[i].minY) continue;
+            Segment *a = boxes[i].seg, *b = boxes[j].seg;
+            if (a->originalId == b->originalId) continue;
+            int count = segmentCrossings(a, b, xs, ys);
+            for (int k = 0; k < count; k++) {
+                if (geomDist(xs[k], ys[k], g_ox, g_oy) < VIS_MIN_VERTEX_GAP) continue;
+                eventBufferAdd(out, getAngle(xs[k], ys[k]), a, b);
+            }
+        }
+    }
+    TED_FREE(boxes);
+}
+
+// --- Simplificação ---
+
+// Dois segmentos sobre a mesma reta: o mesmo segmento, ou pedaços de uma aresta
+// da mesma figura (p.ex. partida no ângulo 0)
+static bool sameLine(const Segment *a, const Segment *b) {
+    if (a == b) return true;
+    if (!a || !b || a->kind != SEG_LINE || b->kind != SEG_LINE) return false;
+    if (a->originalId != b->originalId) return false;
+    double dx = a->p2.x - a->p1.x, dy = a->p2.y - a->p1.y;
+    double len = sqrt(dx * dx + dy * dy);
+    if (len < VIS_TOLERANCE) return false;
+    double c1 = (dx * (b->p1.y - a->p1.y) - dy * (b->p1.x - a->p1.x)) / len;
+    double c2 = (dx * (b->p2.y - a->p1.y) - dy * (b->p2.x - a->p1.x)) / len;
+    return fabs(c1) < VIS_COLLINEAR_EPS && fabs(c2) < VIS_COLLINEAR_EPS;
+}
+
+// Distância de p à reta (a, b); se a e b coincidem, distância a a
+static double pointLineDist(const RegionPoint *p, const RegionPoint *a, const RegionPoint *b) {
+    double dx = b->x - a->x, dy = b->y - a->y;
+    double len = sqrt(dx * dx + dy * dy);
+    if (len < VIS_TOLERANCE) return geomDist(p->x, p->y, a->x, a->y);
+    return fabs(dx * (p->y - a->y) - dy * (p->x - a->x)) / len;
+}
+
+// Acrescenta um vértice. Se ele e o anterior estão na mesma parede e o
+// anterior fica sobre a reta do penúltimo até ele, o anterior é substituído:
+// uma sequência de pontos sobre uma parede vira uma só aresta.
+static void regionAdd(Region *r, const Segment *s, double x, double y) {
+    if (r->count > 0) {
+        RegionPoint *last = &r->pts[r->count - 1];
+        if (fabs(x - last->x) <= VIS_MIN_VERTEX_GAP && fabs(y - last->y) <= VIS_MIN_VERTEX_GAP) return;
+        if (r->count > 1 && s->kind == SEG_LINE && sameLine(last->seg, s)) {
+            RegionPoint p = {x, y, s};
+            if (pointLineDist(last, &r->pts[r->count - 2], &p) < VIS_COLLINEAR_EPS) {
+                last->x = x; last->y = y;
+                return;
+            }
+        }
+    }
+    if (r->count == r->capacity) {
+        int capacity = r->capacity ? r->capacity * 2 : 64;
+        RegionPoint *pts = TED_REALLOC(r->pts, sizeof(RegionPoint) * capacity);
+        if (!pts) return;
+        r->pts = pts;
+        r->capacity = capacity;
+    }
+    r->pts[r->count].x = x;
+    r->pts[r->count].y = y;
+    r->pts[r->count].seg = s;
+    r->count++;
+}
+
+// Douglas-Peucker sobre a polilinha (extremos fixos), com pilha explícita.
+// Compacta r->pts mantendo só os vértices marcados.
+static void regionSimplify(Region *r, double tolerance) {
+    if (tolerance <= 0 || r->count < 3) return;
+    int n = r->count;
+    bool *keep = TED_CALLOC(n, sizeof(bool));
+    int *stack = TED_MALLOC(sizeof(int) * 2 * n);
+    if (!keep || !stack) { TED_FREE(keep); TED_FREE(stack); return; }
+
+    keep[0] = keep[n - 1] = true;
+    int top = 0;
+    stack[top++] = 0; stack[top++] = n - 1;
+    while (top > 0) {
+        int last = stack[--top];
+        int first = stack[--top];
+        double maxDist = 0; int index = -1;
+        for (int i = first + 1; i < last; i++) {
+            double d = pointLineDist(&r->pts[i], &r->pts[first], &r->pts[last]);
+            if (d > maxDist) { maxDist = d; index = i; }
+        }
+        if (index >= 0 && maxDist > tolerance) {
+            keep[index] = true;
+            stack[top++] = first; stack[top++] = index;
+            stack[top++] = index; stack[top++] = last;
+        }
+    }
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (keep[i]) r->pts[m++] = r->pts[i];
+    }
+    r->count = m;
+    TED_FREE(keep);
+    TED_FREE(stack);
+}
+
+void visGetLastRegionBounds(double *minX, double *minY, double *maxX, double *maxY) {
+    *minX = g_regionMinX; *minY = g_regionMinY;
+    *maxX = g_regionMaxX; *maxY = g_regionMaxY;
+}
+
+void visSetSimplifyTolerance(double tolerance) {
+    g_simplifyTolerance = tolerance > 0 ? tolerance : 0.0;
+}
+
+// Acumula o polígono (observador + vértices, como no path) no mapa de cobertura
+static void regionAccumulate(const Region *r) {
+    int n = r->count + 1;
+    double *xs = TED_MALLOC(sizeof(double) * n * 2);
+    if (!xs) return;
+    double *ys = xs + n;
+    xs[0] = g_ox; ys[0] = g_oy;
+    for (int j = 0; j < r->count; j++) {
+        xs[j + 1] = r->pts[j].x;
+        ys[j + 1] = r->pts[j].y;
+    }
+    heatmapAddPolygon(xs, ys, n);
+    TED_FREE(xs);
+}
+
+// --- Desenho ---
+
+static void emitHit(Region *r, Segment *s, double angle) {
+    if (!s) return;
+    double dist = getRaySegDist(s, angle);
+    if (dist >= VIS_INF) return;
+    regionAdd(r, s, g_ox + cos(angle) * dist, g_oy + sin(angle) * dist);
+}
+
+// Tessela o trecho visível de um arco entre dois ângulos do raio. Os vértices
+// são espaçados por igual no ângulo central, porque junto às tangentes um
+// passo pequeno no raio corresponde a um grande troço do círculo. O erro de
+// corda tolerado cresce com a distância ao observador, então arcos distantes
+// recebem menos vértices.
+static void emitArcPoints(Region *r, Segment *s, double fromAngle, double toAngle) {
+    double d0 = getRaySegDist(s, fromAngle);
+    double d1 = getRaySegDist(s, toAngle);
+    if (d0 >= VIS_INF || d1 >= VIS_INF) return;
+
+    // Ângulo central percorrido sobre o círculo. Com o raio a rodar no
+    // sentido anti-horário, o ramo interno roda no mesmo sentido e o ramo
+    // mais próximo (observador fora) no sentido contrário.
+    double phi0 = atan2(g_oy + sin(fromAngle) * d0 - s->p1.y, g_ox + cos(fromAngle) * d0 - s->p1.x);
+    double phi1 = atan2(g_oy + sin(toAngle) * d1 - s->p1.y, g_ox + cos(toAngle) * d1 - s->p1.x);
+    double sweep = phi1 - phi0;
+    if (s->kind == SEG_ARC_INNER) {
+        while (sweep < 0) sweep += 2 * VIS_PI;
+    } else {
+        while (sweep > 0) sweep -= 2 * VIS_PI;
+    }
+
+    double sagitta = VIS_ARC_ERROR * geomDist(s->p1.x, s->p1.y, g_ox, g_oy);
+    if (sagitta < VIS_ARC_MIN_SAGITTA) sagitta = VIS_ARC_MIN_SAGITTA;
+    if (sagitta >= s->radius) return;
+    double maxStep = 2 * acos(1 - sagitta / s->radius);
+
+    int steps = (int)ceil(fabs(sweep) / maxStep);
+    if (steps > VIS_ARC_MAX_STEPS) steps = VIS_ARC_MAX_STEPS;
+    for (int j = 1; j < steps; j++) {
+        double phi = phi0 + sweep * j / steps;
+        regionAdd(r, s, s->p1.x + cos(phi) * s->radius, s->p1.y + sin(phi) * s->radius);
     }
 }
 
 // --- Funções Públicas ---
 
-bool visIsVisible(List figures, double ox, double oy, double tx, double ty) {
+bool visIsVisible(List figures, FigureBounds bounds, double ox, double oy, double tx, double ty) {
+    STATS_INC(STAT_VISIBLE_CALLS);
+    TED_PROBE4(vis__visible__entry, TED_MILLI(ox), TED_MILLI(oy), TED_MILLI(tx), TED_MILLI(ty));
     double old_ox = g_ox; double old_oy = g_oy;
     g_ox = ox; g_oy = oy;
     double distToTarget = sqrt(pow(tx - ox, 2) + pow(ty - oy, 2));
-    if (distToTarget < VIS_TOLERANCE) { g_ox = old_ox; g_oy = old_oy; return true; }
+    if (distToTarget < VIS_TOLERANCE) {
+        g_ox = old_ox; g_oy = old_oy;
+        TED_PROBE1(vis__visible__return, 1);
+        return true;
+    }
+    traceBegin("visIsVisible", "vis");
     
     double angleToTarget = getAngle(tx, ty);
     double minX, minY, maxX, maxY;
-    calculateSceneBounds(figures, ox, oy, &minX, &minY, &maxX, &maxY);
+    calculateSceneBounds(bounds, ox, oy, &minX, &minY, &maxX, &maxY);
     updateBounds(tx, ty, &minX, &minY, &maxX, &maxY);
     
     List segList = listInit();
-    parseFigures(figures, segList, minX, minY, maxX, maxY);
+    parseFigures(figures, segList, NULL, minX, minY, maxX, maxY);
     
     bool blocked = false;
     int i = 0; void *data;
@@ -266,47 +765,89 @@ bool visIsVisible(List figures, double ox, double oy, double tx, double ty) {
         double wallDist = getRaySegDist(s, angleToTarget);
         if (wallDist < distToTarget - 0.1) { blocked = true; break; }
     }
-    i = 0; while ((data = listGetPos(segList, i++))) free(data);
+    i = 0; while ((data = listGetPos(segList, i++))) TED_FREE(data);
     listFree(segList);
     g_ox = old_ox; g_oy = old_oy;
+    traceEnd();
+    TED_PROBE1(vis__visible__return, !blocked);
     return !blocked;
 }
 
-void visDrawRegion(List figures, double ox, double oy, FILE *svgFile, char sortType, int sortThreshold) {
+void visDrawRegion(List figures, FigureBounds bounds, double ox, double oy, SvgWriter svg, char sortType, int sortThreshold) {
     g_ox = ox; g_oy = oy; g_currentAngle = 0.0;
+    TED_PROBE2(vis__region__entry, TED_MILLI(ox), TED_MILLI(oy));
+    traceBegin("visDrawRegion", "vis");
 
+    traceBegin("limites", "vis");
     double minX, minY, maxX, maxY;
-    calculateSceneBounds(figures, ox, oy, &minX, &minY, &maxX, &maxY);
+    calculateSceneBounds(bounds, ox, oy, &minX, &minY, &maxX, &maxY);
+    traceEnd();
 
+    traceBegin("segmentos", "vis");
     List segList = listInit();
-    parseFigures(figures, segList, minX, minY, maxX, maxY);
+    List swapList = listInit();
+    parseFigures(figures, segList, swapList, minX, minY, maxX, maxY);
 
     int numSegs = 0; int k = 0;
-    while (listGetPos(segList, k++)) numSegs++;
-    if (numSegs == 0) { listFree(segList); return; }
+    Segment **segs = (Segment **)listToArray(segList, &numSegs);
+    if (!segs) {
+        listFree(segList); listFree(swapList);
+        traceEnd(); traceEnd();
+        TED_PROBE3(vis__region__return, 0, 0, 0);
+        return;
+    }
+
+    EventBuffer crossings = {NULL, 0, 0};
+    findCrossings(segs, numSegs, &crossings);
 
-    int numEvents = numSegs * 2;
-    Event *events = malloc(sizeof(Event) * numEvents);
-    int evIdx = 0; k = 0; Segment *s;
+    // Cada VertexSwap substitui um END e um START, então 2 * numSegs basta
+    int numEvents = numSegs * 2 + crossings.count;
+    Event *events = TED_MALLOC(sizeof(Event) * numEvents);
+    // Segmentos retirados por um TYPE_CROSS, reinseridos no fim do lote
+    Segment **pending = TED_MALLOC(sizeof(Segment *) * (crossings.count + 1));
+    int evIdx = 0; Segment *s;
     
-    while ((s = (Segment*)listGetPos(segList, k++))) {
-        events[evIdx].angle = s->angleStart; 
-        events[evIdx].type = TYPE_START; 
-        events[evIdx].seg = s; 
-        evIdx++;
-        
-        events[evIdx].angle = s->angleEnd;   
-        events[evIdx].type = TYPE_END;   
-        events[evIdx].seg = s; 
+    for (k = 0; k < numSegs; k++) {
+        s = segs[k];
+        if (!s->startShared) {
+            events[evIdx].angle = s->angleStart; 
+            events[evIdx].type = TYPE_START; 
+            events[evIdx].seg = s; 
+            events[evIdx].next = NULL;
+            evIdx++;
+        }
+        if (!s->endShared) {
+            events[evIdx].angle = s->angleEnd;   
+            events[evIdx].type = TYPE_END;   
+            events[evIdx].seg = s; 
+            events[evIdx].next = NULL;
+            evIdx++;
+        }
+    }
+
+    VertexSwap *sw;
+    k = 0;
+    while ((sw = (VertexSwap*)listGetPos(swapList, k++))) {
+        events[evIdx].angle = sw->angle;
+        events[evIdx].type = TYPE_SWAP;
+        events[evIdx].seg = sw->out;
+        events[evIdx].next = sw->in;
         evIdx++;
     }
+    for (int c = 0; c < crossings.count; c++) events[evIdx++] = crossings.items[c];
+    TED_FREE(crossings.items);
 
+    traceEnd();
+
+    traceBeginArg("ordenação", "vis", "eventos", evIdx);
+    STATS_ADD(STAT_EVENTS, evIdx);
     if (sortType == 'm') mergeSortHybrid(events, 0, evIdx - 1, sortThreshold);
     else qsort(events, evIdx, sizeof(Event), visEventCompare);
+    traceEnd();
 
+    traceBegin("varredura", "vis");
     Tree activeSegs = treeInit(visTreeCompare);
-    fprintf(svgFile, "<path d=\"M %lf %lf ", g_ox, g_oy);
-    double lastX = -9999, lastY = -9999;
+    Region region = {NULL, 0, 0};
 
     for (int i = 0; i < evIdx; ) {
         Event e = events[i];
@@ -314,44 +855,89 @@ void visDrawRegion(List figures, double ox, double oy, FILE *svgFile, char sortT
 
         // 1. Desenha Ponto Anterior
         Segment *oldClosest = (Segment *)treeMin(activeSegs);
-        if (oldClosest) {
-            double dist = getRaySegDist(oldClosest, g_currentAngle);
-            if (dist < VIS_INF) {
-                double hx = g_ox + cos(g_currentAngle) * dist;
-                double hy = g_oy + sin(g_currentAngle) * dist;
-                if (fabs(hx - lastX) > 0.01 || fabs(hy - lastY) > 0.01) {
-                    fprintf(svgFile, "L %lf %lf ", hx, hy);
-                    lastX = hx; lastY = hy;
-                }
-            }
-        }
+        emitHit(&region, oldClosest, g_currentAngle);
 
         // 2. Atualiza Árvore (Batch)
-        while (i < evIdx && fabs(events[i].angle - g_currentAngle) < VIS_TOLERANCE) {
-            if (events[i].type == TYPE_START) treeInsert(activeSegs, events[i].seg);
-            else treeRemove(activeSegs, events[i].seg);
+        int pendingCount = 0;
+        while (i < evIdx && fabs(events[i].angle - e.angle) < VIS_TOLERANCE) {
+            // Cada inserção compara no ângulo do seu evento: o do primeiro
+            // do lote pode ficar antes do início do segmento
+            g_currentAngle = events[i].angle;
+            Segment *evSeg = events[i].seg;
+            if (events[i].type == TYPE_START) {
+                evSeg->node = treeInsertNode(activeSegs, evSeg);
+            } else if (events[i].type == TYPE_SWAP) {
+                // Vértice comum: a aresta que sai é removida e a que entra é
+                // inserida no ângulo atual. Não pode herdar o nó da outra:
+                // uma aresta de outra figura pode passar entre as duas logo
+                // a seguir ao vértice.
+                Segment *inSeg = events[i].next;
+                if (evSeg->node) {
+                    treeRemoveNode(activeSegs, evSeg->node);
+                    evSeg->node = NULL;
+                }
+                inSeg->node = treeInsertNode(activeSegs, inSeg);
+            } else if (events[i].type == TYPE_CROSS) {
+                // Basta tirar um do par que ainda esteja na árvore: sem ele,
+                // os que ficam continuam ordenados, e ao voltar é comparado
+                // já depois do cruzamento
+                Segment *moved = evSeg->node ? evSeg : events[i].next;
+                if (moved->node) {
+                    treeRemoveNode(activeSegs, moved->node);
+                    moved->node = NULL;
+                    pending[pendingCount++] = moved;
+                }
+            } else if (evSeg->node) {
+                // Remoção pelo handle: não depende do comparador angular
+                treeRemoveNode(activeSegs, evSeg->node);
+                evSeg->node = NULL;
+            }
             i++;
         }
+        g_currentAngle = e.angle;
+        // Uma aresta que saiu num TYPE_SWAP deste lote não volta
+        for (int p = 0; p < pendingCount; p++) {
+            if (pending[p]->angleEnd - g_currentAngle < VIS_TOLERANCE) continue;
+            pending[p]->node = treeInsertNode(activeSegs, pending[p]);
+        }
 
         // 3. Desenha Ponto Novo
         Segment *newClosest = (Segment *)treeMin(activeSegs);
-        if (newClosest) {
-            double dist = getRaySegDist(newClosest, g_currentAngle);
-            if (dist < VIS_INF) {
-                double hx = g_ox + cos(g_currentAngle) * dist;
-                double hy = g_oy + sin(g_currentAngle) * dist;
-                if (fabs(hx - lastX) > 0.01 || fabs(hy - lastY) > 0.01) {
-                    fprintf(svgFile, "L %lf %lf ", hx, hy);
-                    lastX = hx; lastY = hy;
-                }
-            }
+        emitHit(&region, newClosest, g_currentAngle);
+
+        // 4. Arco mais próximo até o próximo evento: pontos intermediários
+        if (newClosest && newClosest->kind != SEG_LINE && i < evIdx) {
+            emitArcPoints(&region, newClosest, g_currentAngle, events[i].angle);
         }
     }
 
-    fprintf(svgFile, "Z\" fill=\"yellow\" opacity=\"0.5\" stroke=\"none\" />\n");
+    traceEnd();
+
+    // Só depois de simplificado o polígono é formatado
+    traceBegin("polígono", "vis");
+    regionSimplify(&region, g_simplifyTolerance);
+    if (heatmapIsActive()) regionAccumulate(&region);
+    g_regionMinX = g_regionMaxX = g_ox;
+    g_regionMinY = g_regionMaxY = g_oy;
+    for (int j = 0; j < region.count; j++) {
+        updateBounds(region.pts[j].x, region.pts[j].y, &g_regionMinX, &g_regionMinY, &g_regionMaxX, &g_regionMaxY);
+    }
+    svgWritef(svg, "<path d=\"M %f %f ", g_ox, g_oy);
+    for (int j = 0; j < region.count; j++) {
+        svgWritef(svg, "L %f %f ", region.pts[j].x, region.pts[j].y);
+    }
+    svgWriteStr(svg, "Z\" fill=\"yellow\" opacity=\"0.5\" stroke=\"none\" />\n");
+    TED_PROBE3(vis__region__return, numSegs, evIdx, region.count);
+    TED_FREE(region.pts);
+    traceEnd();
 
     treeFree(activeSegs, NULL);
-    free(events);
-    k = 0; while ((s = (Segment*)listGetPos(segList, k++))) free(s);
+    TED_FREE(events);
+    TED_FREE(pending);
+    for (k = 0; k < numSegs; k++) TED_FREE(segs[k]);
+    TED_FREE(segs);
     listFree(segList);
+    k = 0; while ((sw = (VertexSwap*)listGetPos(swapList, k++))) TED_FREE(sw);
+    listFree(swapList);
+    traceEnd();
 }
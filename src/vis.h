@@ -1,25 +1,45 @@
 #ifndef VIS_H
 #define VIS_H
 
-#include <stdio.h>
+#include "figure.h"
 #include "list.h"
+#include "svgwriter.h"
 
 /**
  * @brief Calcula a região de visibilidade a partir de um ponto e desenha-a no SVG.
  * @param listaFiguras Lista contendo as figuras.
+ * @param bounds Caixa envolvente da cena, que fecha o polígono.
  * @param ox Coordenada X do observador (ponto de visão).
  * @param oy Coordenada Y do observador.
- * @param svgFile Arquivo SVG aberto para escrita onde o polígono será desenhado.
+ * @param svg Escritor do SVG onde o polígono será desenhado.
  */
-void visDrawRegion(List figures, double ox, double oy, FILE *svgFile, char sortType, int sortThreshold);
+void visDrawRegion(List figures, FigureBounds bounds, double ox, double oy, SvgWriter svg, char sortType, int sortThreshold);
 
 /**
   * @brief Verifica se um ponto alvo (tx, ty) é visível a partir da origem (ox, oy).
  * * @param figures Lista de figuras (obstáculos).
+ * @param bounds Caixa envolvente da cena.
  * @param ox, oy Coordenadas da origem (bomba/observador).
  * @param tx, ty Coordenadas do ponto alvo (centro da figura a testar).
  * @return true se o ponto for visível (não bloqueado), false caso contrário.
  */
-bool visIsVisible(List figures, double ox, double oy, double tx, double ty);
+bool visIsVisible(List figures, FigureBounds bounds, double ox, double oy, double tx, double ty);
+
+/**
+ * @brief Define a tolerância de Douglas-Peucker aplicada ao polígono de
+ * visibilidade antes de ser escrito. Vértices consecutivos sobre a mesma
+ * parede são sempre fundidos; com tolerância > 0 também são removidos os que
+ * se afastam menos do que ela da aresta simplificada.
+ * @param tolerance Distância máxima (unidades do SVG); 0 desliga.
+ */
+void visSetSimplifyTolerance(double tolerance);
+
+/**
+ * @brief Obtém a caixa envolvente do último polígono desenhado por
+ * visDrawRegion (incluindo o observador).
+ * @param minX, minY Canto mínimo da caixa.
+ * @param maxX, maxY Canto máximo da caixa.
+ */
+void visGetLastRegionBounds(double *minX, double *minY, double *maxX, double *maxY);
 
 #endif // VIS_H